@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include "agg_font_freetype.h"
+#include FT_OUTLINE_H
 #include "agg_bitset_iterator.h"
 #include "agg_renderer_scanline.h"
 
@@ -319,6 +320,54 @@ namespace agg
 
 
 
+    //------------------------------------------------------------------------
+    // Store the curve-flattened version of an integer outline, so that
+    // cached glyphs can be rasterized without running conv_curve again.
+    template<class Curves, class T, unsigned CoordShift>
+    void flatten_outline(Curves& curves, 
+                         path_storage_integer<T, CoordShift>& path)
+    {
+        const double mult = double(1 << CoordShift);
+        double x, y;
+        unsigned cmd;
+        path.remove_all();
+        curves.rewind(0);
+        while(!is_stop(cmd = curves.vertex(&x, &y)))
+        {
+            if(is_move_to(cmd))
+            {
+                path.move_to(T(floor(x * mult + 0.5)), T(floor(y * mult + 0.5)));
+            }
+            else if(is_vertex(cmd))
+            {
+                path.line_to(T(floor(x * mult + 0.5)), T(floor(y * mult + 0.5)));
+            }
+        }
+    }
+
+
+
+    //------------------------------------------------------------------------
+    // aggdraw: the flattened outline of a loaded glyph, in pixels with y up,
+    // for building distance fields in agg_font_sdf.cpp.
+    bool flatten_ft_outline(const FT_Outline& outline,
+                            double approximation_scale,
+                            path_storage_integer<int32, 6>& flat)
+    {
+        path_storage_integer<int32, 6> path;
+        conv_curve<path_storage_integer<int32, 6> > curves(path);
+        curves.approximation_scale(approximation_scale);
+        if(!decompose_ft_outline(outline, false, path, conv_coord_none))
+        {
+            flat.remove_all();
+            return false;
+        }
+        flatten_outline(curves, flat);
+        return true;
+    }
+
+
+
     //------------------------------------------------------------------------
     template<class Scanline, class ScanlineStorage>
     void decompose_ft_bitmap_mono(const FT_Bitmap& bitmap,
@@ -440,6 +489,7 @@ namespace agg
         m_width(0),
         m_hinting(true),
         m_flip_y(false),
+        m_approximation_scale(4.0),
         m_library_initialized(false),
         m_library(0),
         m_faces(new FT_Face [max_faces]),
@@ -458,6 +508,8 @@ namespace agg
 
         m_path16(),
         m_path32(),
+        m_flat16(),
+        m_flat32(),
         m_curves16(m_path16),
         m_curves32(m_path32),
         m_scanline_aa(),
@@ -470,10 +522,24 @@ namespace agg
         m_matrix.xy = 0;
         m_matrix.yx = 0;
         m_matrix.yy = 0x10000L;
-        m_curves16.approximation_scale(4.0);
-        m_curves32.approximation_scale(4.0);
-        m_last_error = FT_Init_FreeType(&m_library);
-        if(m_last_error == 0) m_library_initialized = true;
+        m_curves16.approximation_scale(m_approximation_scale);
+        m_curves32.approximation_scale(m_approximation_scale);
+    }
+
+
+    //------------------------------------------------------------------------
+    // FreeType is initialized on first use, so that creating an engine
+    // costs nothing until a font is actually loaded.
+    // The flag is checked and set without a lock; callers sharing an
+    // engine between threads serialize the first use.
+    bool font_engine_freetype_base::init_library()
+    {
+        if(!m_library_initialized)
+        {
+            m_last_error = FT_Init_FreeType(&m_library);
+            if(m_last_error == 0) m_library_initialized = true;
+        }
+        return m_library_initialized;
     }
 
 
@@ -499,13 +565,18 @@ namespace agg
 
 
     //------------------------------------------------------------------------
+    // When font_mem is given the face is created from that buffer, and
+    // font_name is only the key the face is pooled under. The buffer must
+    // stay valid until the face is released with unload_font().
     bool font_engine_freetype_base::load_font(const char* font_name, 
                                               unsigned face_index,
-                                              glyph_rendering ren_type)
+                                              glyph_rendering ren_type,
+                                              const char* font_mem, 
+                                              const long font_mem_size)
     {
         bool ret = false;
 
-        if(m_library_initialized)
+        if(init_library())
         {
             m_last_error = 0;
 
@@ -530,10 +601,21 @@ namespace agg
                     m_num_faces = m_max_faces - 1;
                 }
 
-                m_last_error = FT_New_Face(m_library,
-                                           font_name,
-                                           face_index,
-                                           &m_faces[m_num_faces]);
+                if(font_mem && font_mem_size)
+                {
+                    m_last_error = FT_New_Memory_Face(m_library,
+                                                      (const FT_Byte*)font_mem,
+                                                      font_mem_size,
+                                                      face_index,
+                                                      &m_faces[m_num_faces]);
+                }
+                else
+                {
+                    m_last_error = FT_New_Face(m_library,
+                                               font_name,
+                                               face_index,
+                                               &m_faces[m_num_faces]);
+                }
                 if(m_last_error == 0)
                 {
                     m_face_names[m_num_faces] = new char [strlen(font_name) + 1];
@@ -597,6 +679,17 @@ namespace agg
                         m_glyph_rendering = glyph_ren_native_gray8;
                     }
                     break;
+
+                case glyph_ren_outline_flat:
+                    if(FT_IS_SCALABLE(m_cur_face))
+                    {
+                        m_glyph_rendering = glyph_ren_outline_flat;
+                    }
+                    else
+                    {
+                        m_glyph_rendering = glyph_ren_native_gray8;
+                    }
+                    break;
                 }
 
                 update_transform();
@@ -606,6 +699,29 @@ namespace agg
     }
 
 
+    //------------------------------------------------------------------------
+    void font_engine_freetype_base::unload_font(const char* font_name)
+    {
+        int idx = find_face(font_name);
+        if(idx < 0) return;
+
+        if(m_cur_face == m_faces[idx])
+        {
+            m_cur_face = 0;
+            m_name = 0;
+        }
+        delete [] m_face_names[idx];
+        FT_Done_Face(m_faces[idx]);
+        --m_num_faces;
+        memmove(m_faces + idx, 
+                m_faces + idx + 1, 
+                (m_num_faces - idx) * sizeof(FT_Face));
+        memmove(m_face_names + idx, 
+                m_face_names + idx + 1, 
+                (m_num_faces - idx) * sizeof(char*));
+    }
+
+
     //------------------------------------------------------------------------
     bool font_engine_freetype_base::attach(const char* file_name)
     {
@@ -735,6 +851,22 @@ namespace agg
         }
     }
 
+    //------------------------------------------------------------------------
+    // Outline glyphs are flattened once when they are cached, so the scale
+    // is part of the signature, and glyphs flattened for one scale are
+    // never reused for another.
+    void font_engine_freetype_base::approximation_scale(double s)
+    {
+        if(s == m_approximation_scale) return;
+        m_approximation_scale = s;
+        m_curves16.approximation_scale(s);
+        m_curves32.approximation_scale(s);
+        if(m_cur_face)
+        {
+            update_signature();
+        }
+    }
+
     //------------------------------------------------------------------------
     void font_engine_freetype_base::update_signature()
     {
@@ -763,7 +895,7 @@ namespace agg
             }
 
             sprintf(m_signature, 
-                    "%s,%u,%d,%d,%d:%dx%d,%d,%d,%d,%d,%d,%d,%08X", 
+                    "%s,%u,%d,%d,%d:%dx%d,%d,%d,%d,%d,%d,%d,%08X,%g", 
                     m_name,
                     m_char_map,
                     m_face_index,
@@ -777,7 +909,8 @@ namespace agg
                     m_matrix.yy,
                     int(m_hinting),
                     int(m_flip_y),
-                    gamma_hash);
+                    gamma_hash,
+                    m_approximation_scale);
             ++m_change_stamp;
         }
     }
@@ -811,7 +944,8 @@ namespace agg
 
 
     //------------------------------------------------------------------------
-    bool font_engine_freetype_base::prepare_glyph(unsigned glyph_code)
+    bool font_engine_freetype_base::prepare_glyph(unsigned glyph_code,
+                                                  double subpixel_x)
     {
         bool flip = false;
 
@@ -821,6 +955,14 @@ namespace agg
                                      m_glyph_index, 
                                      m_hinting ? FT_LOAD_DEFAULT : FT_LOAD_NO_HINTING);
 //                                     m_hinting ? FT_LOAD_FORCE_AUTOHINT : FT_LOAD_NO_HINTING);
+        if(m_last_error == 0 && subpixel_x != 0.0 &&
+           m_cur_face->glyph->format == FT_GLYPH_FORMAT_OUTLINE)
+        {
+            // Shift the outline before rendering, so that bitmap glyphs
+            // can be cached at fractional horizontal positions.
+            FT_Outline_Translate(&m_cur_face->glyph->outline,
+                                 FT_Pos(subpixel_x * 64.0 + 0.5), 0);
+        }
         if(m_last_error == 0)
         {
             switch(m_glyph_rendering)
@@ -920,6 +1062,43 @@ namespace agg
                 }
                 return false;
 
+            case glyph_ren_outline_flat:
+                if(m_last_error == 0)
+                {
+                    rect_d bnd;
+                    if(m_flag32)
+                    {
+                        m_path32.remove_all();
+                        decompose_ft_outline(m_cur_face->glyph->outline,
+                                             flip, 
+                                             m_path32, 
+                                             conv_coord_none);
+                        flatten_outline(m_curves32, m_flat32);
+                        bnd         = m_flat32.bounding_rect();
+                        m_data_size = m_flat32.byte_size();
+                    }
+                    else
+                    {
+                        m_path16.remove_all();
+                        decompose_ft_outline(m_cur_face->glyph->outline,
+                                             flip, 
+                                             m_path16, 
+                                             conv_coord_none);
+                        flatten_outline(m_curves16, m_flat16);
+                        bnd         = m_flat16.bounding_rect();
+                        m_data_size = m_flat16.byte_size();
+                    }
+                    m_data_type = glyph_data_outline;
+                    m_bounds.x1 = int(floor(bnd.x1));
+                    m_bounds.y1 = int(floor(bnd.y1));
+                    m_bounds.x2 = int(ceil(bnd.x2));
+                    m_bounds.y2 = int(ceil(bnd.y2));
+                    m_advance_x = double(m_cur_face->glyph->advance.x) / 64.0;
+                    m_advance_y = double(m_cur_face->glyph->advance.y) / 64.0;
+                    return true;
+                }
+                return false;
+
             case glyph_ren_agg_mono:
                 if(m_last_error == 0)
                 {
@@ -1010,7 +1189,12 @@ namespace agg
             case glyph_data_mono:    m_scanlines_bin.serialize(data); break;
             case glyph_data_gray8:   m_scanlines_aa.serialize(data);  break;
             case glyph_data_outline: 
-                if(m_flag32)
+                if(m_glyph_rendering == glyph_ren_outline_flat)
+                {
+                    if(m_flag32) m_flat32.serialize(data);
+                    else         m_flat16.serialize(data);
+                }
+                else if(m_flag32)
                 {
                     m_path32.serialize(data);
                 }
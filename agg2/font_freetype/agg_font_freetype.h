@@ -55,7 +55,9 @@ namespace agg
         // Set font parameters
         //--------------------------------------------------------------------
         void resolution(unsigned dpi);
-        bool load_font(const char* font_name, unsigned face_index, glyph_rendering ren_type);
+        bool load_font(const char* font_name, unsigned face_index, glyph_rendering ren_type,
+                       const char* font_mem = 0, const long font_mem_size = 0);
+        void unload_font(const char* font_name);
         bool attach(const char* file_name);
         bool char_map(FT_Encoding map);
         bool height(double h);
@@ -64,6 +66,7 @@ namespace agg
         void transform(double xx, double xy, double yx, double yy);
         void hinting(bool h);
         void flip_y(bool f);
+        void approximation_scale(double s);
 
         // Set Gamma
         //--------------------------------------------------------------------
@@ -83,6 +86,8 @@ namespace agg
         double      width()        const { return double(m_width) / 64.0;  }
         bool        hinting()      const { return m_hinting;    }
         bool        flip_y()       const { return m_flip_y;     }
+        double      approximation_scale() const { return m_approximation_scale; }
+        FT_Library  library()            { init_library(); return m_library; }
 
 
         // Interface mandatory to implement for font_cache_manager
@@ -90,7 +95,7 @@ namespace agg
         const char*     font_signature() const { return m_signature;    }
         int             change_stamp()   const { return m_change_stamp; }
 
-        bool            prepare_glyph(unsigned glyph_code);
+        bool            prepare_glyph(unsigned glyph_code, double subpixel_x = 0.0);
         unsigned        glyph_index() const { return m_glyph_index; }
         unsigned        data_size()   const { return m_data_size;   }
         glyph_data_type data_type()   const { return m_data_type;   }
@@ -105,6 +110,7 @@ namespace agg
         font_engine_freetype_base(const font_engine_freetype_base&);
         const font_engine_freetype_base& operator = (const font_engine_freetype_base&);
 
+        bool init_library();
         void update_char_size();
         void update_signature();
         void update_transform();
@@ -123,6 +129,7 @@ namespace agg
         FT_Matrix       m_matrix;
         bool            m_hinting;
         bool            m_flip_y;
+        double          m_approximation_scale;
         bool            m_library_initialized;
         FT_Library      m_library;    // handle to library    
         FT_Face*        m_faces;      // A pool of font faces
@@ -143,6 +150,8 @@ namespace agg
 
         path_storage_integer<int16, 6>              m_path16;
         path_storage_integer<int32, 6>              m_path32;
+        path_storage_integer<int16, 6>              m_flat16;
+        path_storage_integer<int32, 6>              m_flat32;
         conv_curve<path_storage_integer<int16, 6> > m_curves16;
         conv_curve<path_storage_integer<int32, 6> > m_curves32;
         scanline_u8              m_scanline_aa;
@@ -155,6 +164,15 @@ namespace agg
 
 
 
+    //------------------------------------------------------------------------
+    // aggdraw: the curve-flattened outline of a loaded glyph, in pixels with
+    // y up. Used by font_sdf_atlas.
+    bool flatten_ft_outline(const FT_Outline& outline,
+                            double approximation_scale,
+                            path_storage_integer<int32, 6>& flat);
+
+
+
     //------------------------------------------------font_engine_freetype_int16
     // This class uses values of type int16 (10.6 format) for the vector cache. 
     // The vector cache is compact, but when rendering glyphs of height
@@ -0,0 +1,320 @@
+//----------------------------------------------------------------------------
+// aggdraw addition to Anti-Grain Geometry 2.2; not part of the AGG
+// distribution.
+// Copyright (c) 2026 by AggDraw Developers
+//
+// Distributed under the aggdraw license; see LICENSE.txt.
+//
+//----------------------------------------------------------------------------
+
+#include <math.h>
+#include <string.h>
+#include "agg_font_sdf.h"
+#include "agg_font_freetype.h"
+
+namespace agg
+{
+
+    //------------------------------------------------------------------------
+    font_sdf_atlas::~font_sdf_atlas()
+    {
+        reset();
+        delete [] m_data;
+        delete [] m_name;
+        if(m_face) FT_Done_Face(m_face);
+    }
+
+
+    //------------------------------------------------------------------------
+    font_sdf_atlas::font_sdf_atlas(FT_Library library, const char* font_name,
+                                   unsigned base_size, unsigned spread,
+                                   const char* font_mem, long font_mem_size) :
+        m_name(new char [strlen(font_name) + 1]),
+        m_face(0),
+        m_base_size(base_size),
+        m_spread(spread ? spread : 1),
+        m_data(0),
+        m_height(0),
+        m_shelf_x(0),
+        m_shelf_y(0),
+        m_shelf_height(0)
+    {
+        strcpy(m_name, font_name);
+        memset(m_glyphs, 0, sizeof(m_glyphs));
+        FT_Error error;
+        if(font_mem && font_mem_size)
+        {
+            error = FT_New_Memory_Face(library, (const FT_Byte*)font_mem,
+                                       font_mem_size, 0, &m_face);
+        }
+        else
+        {
+            error = FT_New_Face(library, font_name, 0, &m_face);
+        }
+        if(error != 0)
+        {
+            m_face = 0;
+        }
+        else if(FT_Set_Pixel_Sizes(m_face, 0, m_base_size) != 0)
+        {
+            FT_Done_Face(m_face);
+            m_face = 0;
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    double font_sdf_atlas::ascender() const
+    {
+        return m_face ? m_face->size->metrics.ascender / 64.0 : 0.0;
+    }
+
+    //------------------------------------------------------------------------
+    double font_sdf_atlas::descender() const
+    {
+        return m_face ? m_face->size->metrics.descender / 64.0 : 0.0;
+    }
+
+    //------------------------------------------------------------------------
+    double font_sdf_atlas::line_height() const
+    {
+        return m_face ? m_face->size->metrics.height / 64.0 : 0.0;
+    }
+
+    //------------------------------------------------------------------------
+    unsigned font_sdf_atlas::byte_size() const
+    {
+        return unsigned(atlas_width) * m_height;
+    }
+
+
+    //------------------------------------------------------------------------
+    void font_sdf_atlas::reset()
+    {
+        unsigned i, j;
+        for(i = 0; i < 256; ++i)
+        {
+            if(m_glyphs[i])
+            {
+                for(j = 0; j < 256; ++j)
+                {
+                    glyph_sdf* gl = m_glyphs[i][j];
+                    while(gl)
+                    {
+                        glyph_sdf* next = gl->next;
+                        delete gl;
+                        gl = next;
+                    }
+                }
+                delete [] m_glyphs[i];
+                m_glyphs[i] = 0;
+            }
+        }
+        if(m_data) memset(m_data, 0, atlas_width * m_height);
+        m_shelf_x = 0;
+        m_shelf_y = 0;
+        m_shelf_height = 0;
+    }
+
+
+    //------------------------------------------------------------------------
+    // Simple shelf packer. The atlas grows downwards as needed, up to
+    // atlas_max_height.
+    bool font_sdf_atlas::allocate(int width, int height, int* x, int* y)
+    {
+        if(width > atlas_width) return false;
+        if(m_shelf_x + width > atlas_width)
+        {
+            m_shelf_y += m_shelf_height;
+            m_shelf_x = 0;
+            m_shelf_height = 0;
+        }
+        if(m_shelf_y + height > atlas_max_height) return false;
+        if(m_shelf_y + height > m_height)
+        {
+            int new_height = m_height ? m_height * 2 : 128;
+            while(m_shelf_y + height > new_height) new_height *= 2;
+            if(new_height > atlas_max_height) new_height = atlas_max_height;
+            int8u* data = new int8u [atlas_width * new_height];
+            memset(data, 0, atlas_width * new_height);
+            if(m_data) memcpy(data, m_data, atlas_width * m_height);
+            delete [] m_data;
+            m_data = data;
+            m_height = new_height;
+            m_rbuf.attach(m_data, atlas_width, m_height, atlas_width);
+        }
+        *x = m_shelf_x;
+        *y = m_shelf_y;
+        m_shelf_x += width;
+        if(height > m_shelf_height) m_shelf_height = height;
+        return true;
+    }
+
+
+    //------------------------------------------------------------------------
+    // Exact distances from the pixel centers to the flattened outline in
+    // m_outline, signed by the fill rule of the outline. Only edges within
+    // the spread of a row can change its values, so the others are skipped.
+    void font_sdf_atlas::render_field(const glyph_sdf& gl, bool even_odd)
+    {
+        double x, y, start_x = 0, start_y = 0, last_x = 0, last_y = 0;
+        unsigned cmd;
+        edge e;
+        m_edges.remove_all();
+        m_outline.rewind(0);
+        while(!is_stop(cmd = m_outline.vertex(&x, &y)))
+        {
+            if(is_move_to(cmd))
+            {
+                start_x = last_x = x;
+                start_y = last_y = y;
+                continue;
+            }
+            if(is_vertex(cmd))
+            {
+                e.x1 = last_x; e.y1 = last_y;
+                e.x2 = last_x = x;
+                e.y2 = last_y = y;
+            }
+            else
+            {
+                e.x1 = last_x; e.y1 = last_y;
+                e.x2 = last_x = start_x;
+                e.y2 = last_y = start_y;
+            }
+            if(e.x1 != e.x2 || e.y1 != e.y2) m_edges.add(e);
+        }
+
+        double s = m_spread;
+        double k = value_scale();
+        unsigned n;
+        int i, j;
+        for(j = 0; j < gl.height; ++j)
+        {
+            int8u* dst = m_rbuf.row(gl.y + j) + gl.x;
+            double py = gl.top - j - 0.5;
+            for(i = 0; i < gl.width; ++i)
+            {
+                double px = gl.left + i + 0.5;
+                double best = s * s;
+                int winding = 0;
+                for(n = 0; n < m_edges.size(); ++n)
+                {
+                    const edge& ed = m_edges[n];
+                    if((ed.y1 < py - s && ed.y2 < py - s) ||
+                       (ed.y1 > py + s && ed.y2 > py + s)) continue;
+
+                    double dx = ed.x2 - ed.x1;
+                    double dy = ed.y2 - ed.y1;
+                    double cross = dx * (py - ed.y1) - (px - ed.x1) * dy;
+                    if(ed.y1 <= py)
+                    {
+                        if(ed.y2 > py && cross > 0) ++winding;
+                    }
+                    else
+                    {
+                        if(ed.y2 <= py && cross < 0) --winding;
+                    }
+
+                    double t = ((px - ed.x1) * dx + (py - ed.y1) * dy) /
+                               (dx * dx + dy * dy);
+                    if(t < 0.0) t = 0.0;
+                    if(t > 1.0) t = 1.0;
+                    double ex = ed.x1 + t * dx - px;
+                    double ey = ed.y1 + t * dy - py;
+                    double d2 = ex * ex + ey * ey;
+                    if(d2 < best) best = d2;
+                }
+                bool inside = even_odd ? (winding & 1) != 0 : winding != 0;
+                double d = sqrt(best);
+                double value = 128.0 + (inside ? d : -d) * k;
+                if(value < 0.0)   value = 0.0;
+                if(value > 255.0) value = 255.0;
+                dst[i] = int8u(value + 0.5);
+            }
+        }
+    }
+
+
+    //------------------------------------------------------------------------
+    const glyph_sdf* font_sdf_atlas::glyph(unsigned glyph_code)
+    {
+        if(m_face == 0) return 0;
+
+        unsigned msb = (glyph_code >> 8) & 0xFF;
+        unsigned lsb = glyph_code & 0xFF;
+        glyph_sdf* cached = m_glyphs[msb] ? m_glyphs[msb][lsb] : 0;
+        for(; cached; cached = cached->next)
+        {
+            if(cached->glyph_code == glyph_code) return cached;
+        }
+
+        unsigned index = FT_Get_Char_Index(m_face, glyph_code);
+        if(FT_Load_Glyph(m_face, index, 
+                         FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP) != 0) return 0;
+        if(m_face->glyph->format != FT_GLYPH_FORMAT_OUTLINE) return 0;
+        const FT_Outline& outline = m_face->glyph->outline;
+        if(!flatten_ft_outline(outline, 2.0, m_outline)) return 0;
+
+        int s = int(m_spread);
+        glyph_sdf gl;
+        gl.glyph_code  = glyph_code;
+        gl.glyph_index = index;
+        gl.x = gl.y    = 0;
+        gl.width       = 0;
+        gl.height      = 0;
+        gl.left        = 0;
+        gl.top         = 0;
+        gl.advance_x   = m_face->glyph->advance.x / 64.0;
+        gl.advance_y   = m_face->glyph->advance.y / 64.0;
+        gl.next        = 0;
+
+        if(m_outline.size())
+        {
+            rect_d bnd = m_outline.bounding_rect();
+            int x1 = int(floor(bnd.x1));
+            int y1 = int(floor(bnd.y1));
+            int x2 = int(ceil(bnd.x2));
+            int y2 = int(ceil(bnd.y2));
+            gl.width  = x2 - x1 + 2 * s;
+            gl.height = y2 - y1 + 2 * s;
+            gl.left   = x1 - s;
+            gl.top    = y2 + s;
+            if(!allocate(gl.width, gl.height, &gl.x, &gl.y))
+            {
+                reset();
+                if(!allocate(gl.width, gl.height, &gl.x, &gl.y)) return 0;
+            }
+            render_field(gl, (outline.flags & FT_OUTLINE_EVEN_ODD_FILL) != 0);
+        }
+
+        if(m_glyphs[msb] == 0)
+        {
+            m_glyphs[msb] = new glyph_sdf* [256];
+            memset(m_glyphs[msb], 0, sizeof(glyph_sdf*) * 256);
+        }
+        glyph_sdf* entry = new glyph_sdf(gl);
+        entry->next = m_glyphs[msb][lsb];
+        m_glyphs[msb][lsb] = entry;
+        return entry;
+    }
+
+
+    //------------------------------------------------------------------------
+    bool font_sdf_atlas::add_kerning(const glyph_sdf* first,
+                                     const glyph_sdf* second,
+                                     double* x, double* y) const
+    {
+        if(m_face && first && second && FT_HAS_KERNING(m_face))
+        {
+            FT_Vector delta;
+            FT_Get_Kerning(m_face, first->glyph_index, second->glyph_index,
+                           FT_KERNING_DEFAULT, &delta);
+            *x += double(delta.x) / 64.0;
+            *y += double(delta.y) / 64.0;
+            return true;
+        }
+        return false;
+    }
+
+}
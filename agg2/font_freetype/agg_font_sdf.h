@@ -0,0 +1,115 @@
+//----------------------------------------------------------------------------
+// aggdraw addition to Anti-Grain Geometry 2.2; not part of the AGG
+// distribution.
+// Copyright (c) 2026 by AggDraw Developers
+//
+// Distributed under the aggdraw license; see LICENSE.txt.
+//
+//----------------------------------------------------------------------------
+//
+// Signed distance field glyph atlas, built from FreeType outlines at a
+// single base size. Glyphs are added lazily and can be rendered at any
+// size or rotation with span_sdf. When the atlas is full it is cleared
+// and filled again with the glyphs in use.
+//
+// See implementation agg_font_sdf.cpp
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_FONT_SDF_INCLUDED
+#define AGG_FONT_SDF_INCLUDED
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "agg_basics.h"
+#include "agg_array.h"
+#include "agg_rendering_buffer.h"
+#include "agg_path_storage_integer.h"
+
+namespace agg
+{
+
+    //---------------------------------------------------------------glyph_sdf
+    struct glyph_sdf
+    {
+        unsigned glyph_code;
+        unsigned glyph_index;
+        int      x, y;          // position of the field in the atlas
+        int      width, height; // size of the field, including the spread
+        double   left, top;     // offset of the field from the pen (y up)
+        double   advance_x;
+        double   advance_y;
+        glyph_sdf* next;        // next glyph with the same low 16 bits
+    };
+
+
+    //----------------------------------------------------------font_sdf_atlas
+    class font_sdf_atlas
+    {
+    public:
+        enum
+        {
+            atlas_width      = 512,
+            atlas_max_height = 2048
+        };
+
+        //--------------------------------------------------------------------
+        ~font_sdf_atlas();
+        font_sdf_atlas(FT_Library library, const char* font_name,
+                       unsigned base_size = 48, unsigned spread = 6,
+                       const char* font_mem = 0, long font_mem_size = 0);
+
+        //--------------------------------------------------------------------
+        bool        ok()          const { return m_face != 0; }
+        const char* name()        const { return m_name; }
+        unsigned    base_size()   const { return m_base_size; }
+        unsigned    spread()      const { return m_spread; }
+        double      ascender()    const;
+        double      descender()   const;
+        double      line_height() const;
+
+        //--------------------------------------------------------------------
+        // Field values change by this much per atlas pixel.
+        double      value_scale() const { return 127.0 / m_spread; }
+
+        //--------------------------------------------------------------------
+        // Glyphs stay valid until the next call, which may clear the atlas.
+        const glyph_sdf*        glyph(unsigned glyph_code);
+        bool                    add_kerning(const glyph_sdf* first,
+                                            const glyph_sdf* second,
+                                            double* x, double* y) const;
+        const rendering_buffer& image() const { return m_rbuf; }
+        unsigned                byte_size() const;
+
+    private:
+        font_sdf_atlas(const font_sdf_atlas&);
+        const font_sdf_atlas& operator = (const font_sdf_atlas&);
+
+        struct edge
+        {
+            double x1, y1, x2, y2;
+        };
+
+        bool allocate(int width, int height, int* x, int* y);
+        void reset();
+        void render_field(const glyph_sdf& gl, bool even_odd);
+
+        char*            m_name;
+        FT_Face          m_face;
+        unsigned         m_base_size;
+        unsigned         m_spread;
+        glyph_sdf**      m_glyphs[256];
+        int8u*           m_data;
+        int              m_height;
+        int              m_shelf_x;
+        int              m_shelf_y;
+        int              m_shelf_height;
+        rendering_buffer m_rbuf;
+        path_storage_integer<int32, 6> m_outline;
+        pod_deque<edge, 6>             m_edges;
+    };
+
+}
+
+#endif
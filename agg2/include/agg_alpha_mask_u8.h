@@ -42,6 +42,16 @@ namespace agg
         }
     };
 
+    //---------------------------------------------------------amask_multiply
+    // aggdraw: cover times mask over 255, rounded to nearest. The original
+    // (cover * mask) >> 8 lost a level at full cover, and biasing it by
+    // cover_full leaked coverage through a mask value of 1.
+    inline int8u amask_multiply(unsigned cover, unsigned mask)
+    {
+        unsigned t = cover * mask + 128;
+        return int8u((t + (t >> 8)) >> 8);
+    }
+
     //==========================================================alpha_mask_u8
     template<unsigned Step=1, unsigned Offset=0, class MaskF=one_component_mask_u8>
     class alpha_mask_u8
@@ -85,10 +95,9 @@ namespace agg
                x < (int)m_rbuf->width() && 
                y <= (int)m_rbuf->height())
             {
-                return (cover_type)((val * 
-                                     m_mask_function.calculate(
-                                        m_rbuf->row(y) + x * Step + Offset)) >> 
-                                     cover_shift);
+                return amask_multiply(val, 
+                                      m_mask_function.calculate(
+                                          m_rbuf->row(y) + x * Step + Offset));
             }
             return 0;
         }
@@ -187,9 +196,8 @@ namespace agg
             const int8u* mask = m_rbuf->row(y) + x * Step + Offset;
             do
             {
-                *covers = (cover_type)(((*covers) * 
-                                       m_mask_function.calculate(mask)) >> 
-                                       cover_shift);
+                *covers = amask_multiply(*covers, 
+                                         m_mask_function.calculate(mask));
                 ++covers;
                 mask += Step;
             }
@@ -288,9 +296,8 @@ namespace agg
             const int8u* mask = m_rbuf->row(y) + x * Step + Offset;
             do
             {
-                *covers = (cover_type)(((*covers) * 
-                                       m_mask_function.calculate(mask)) >> 
-                                       cover_shift);
+                *covers = amask_multiply(*covers, 
+                                         m_mask_function.calculate(mask));
                 ++covers;
                 mask += m_rbuf->stride();
             }
@@ -380,10 +387,9 @@ namespace agg
         //--------------------------------------------------------------------
         cover_type combine_pixel(int x, int y, cover_type val) const
         {
-            return (cover_type)((val * 
-                                 m_mask_function.calculate(
-                                    m_rbuf->row(y) + x * Step + Offset)) >> 
-                                 cover_shift);
+            return amask_multiply(val, 
+                                  m_mask_function.calculate(
+                                      m_rbuf->row(y) + x * Step + Offset));
         }
 
 
@@ -407,9 +413,8 @@ namespace agg
             const int8u* mask = m_rbuf->row(y) + x * Step + Offset;
             do
             {
-                *dst = (cover_type)(((*dst) * 
-                                    m_mask_function.calculate(mask)) >> 
-                                    cover_shift);
+                *dst = amask_multiply(*dst, 
+                                      m_mask_function.calculate(mask));
                 ++dst;
                 mask += Step;
             }
@@ -436,9 +441,8 @@ namespace agg
             const int8u* mask = m_rbuf->row(y) + x * Step + Offset;
             do
             {
-                *dst = (cover_type)(((*dst) * 
-                                    m_mask_function.calculate(mask)) >> 
-                                    cover_shift);
+                *dst = amask_multiply(*dst, 
+                                      m_mask_function.calculate(mask));
                 ++dst;
                 mask += m_rbuf->stride();
             }
@@ -173,7 +173,69 @@ namespace agg
         }
         return np;
     }
-    
+
+
+    //--------------------------------------------------------clip_line_point
+    // One Liang-Barsky boundary test: narrows [t1, t2] to the part of the
+    // segment on the inside of the boundary. Returns false if nothing is
+    // left.
+    inline bool clip_line_point(double p, double q, double* t1, double* t2)
+    {
+        if(p == 0.0) return q >= 0.0;
+        double r = q / p;
+        if(p < 0.0)
+        {
+            if(r > *t2) return false;
+            if(r > *t1) *t1 = r;
+        }
+        else
+        {
+            if(r < *t1) return false;
+            if(r < *t2) *t2 = r;
+        }
+        return true;
+    }
+
+
+    //------------------------------------------------------clip_line_segment
+    // Clips a single line segment in place. Returns 4 if the segment is
+    // entirely invisible, otherwise a combination of 1 (the first point
+    // was moved) and 2 (the second point was moved).
+    template<class T>
+    inline unsigned clip_line_segment(T* x1, T* y1, T* x2, T* y2,
+                                      const rect_base<T>& clip_box)
+    {
+        double dx = double(*x2) - double(*x1);
+        double dy = double(*y2) - double(*y1);
+        double t1 = 0.0;
+        double t2 = 1.0;
+
+        if(!clip_line_point(-dx, double(*x1) - clip_box.x1, &t1, &t2) ||
+           !clip_line_point( dx, clip_box.x2 - double(*x1), &t1, &t2) ||
+           !clip_line_point(-dy, double(*y1) - clip_box.y1, &t1, &t2) ||
+           !clip_line_point( dy, clip_box.y2 - double(*y1), &t1, &t2))
+        {
+            return 4;
+        }
+
+        unsigned ret = 0;
+        double x = double(*x1);
+        double y = double(*y1);
+        if(t2 < 1.0)
+        {
+            *x2 = (T)(x + t2 * dx);
+            *y2 = (T)(y + t2 * dy);
+            ret |= 2;
+        }
+        if(t1 > 0.0)
+        {
+            *x1 = (T)(x + t1 * dx);
+            *y1 = (T)(y + t1 * dy);
+            ret |= 1;
+        }
+        return ret;
+    }
+
 
 }
 
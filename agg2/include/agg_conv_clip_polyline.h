@@ -0,0 +1,195 @@
+//----------------------------------------------------------------------------
+// aggdraw addition to Anti-Grain Geometry 2.2; not part of the AGG
+// distribution.
+// Copyright (c) 2026 by AggDraw Developers
+//
+// Distributed under the aggdraw license; see LICENSE.txt.
+//
+//----------------------------------------------------------------------------
+//
+// Polyline clipping converter, meant to be placed in front of a stroker.
+// A closed contour that lies entirely inside the clip box keeps its close
+// flag, so its joins are unchanged. A contour that was clipped is emitted
+// as open pieces, since closing them would add edges along the box; it is
+// started at a vertex outside the box, so no piece ends at a lost join.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_CONV_CLIP_POLYLINE_INCLUDED
+#define AGG_CONV_CLIP_POLYLINE_INCLUDED
+
+#include "agg_basics.h"
+#include "agg_array.h"
+#include "agg_vpgen_clip_polyline.h"
+#include "agg_vertex_iterator.h"
+
+namespace agg
+{
+
+    //======================================================conv_clip_polyline
+    template<class VertexSource> class conv_clip_polyline
+    {
+    public:
+        conv_clip_polyline(VertexSource& source) : m_source(&source) {}
+
+        void set_source(VertexSource& source) { m_source = &source; }
+
+        void clip_box(double x1, double y1, double x2, double y2)
+        {
+            m_vpgen.clip_box(x1, y1, x2, y2);
+        }
+
+        double x1() const { return m_vpgen.x1(); }
+        double y1() const { return m_vpgen.y1(); }
+        double x2() const { return m_vpgen.x2(); }
+        double y2() const { return m_vpgen.y2(); }
+
+        void rewind(unsigned path_id);
+        unsigned vertex(double* x, double* y);
+
+        typedef conv_clip_polyline<VertexSource> source_type;
+        typedef vertex_iterator<source_type> iterator;
+        iterator begin(unsigned id) { return iterator(*this, id); }
+        iterator end() { return iterator(path_cmd_stop); }
+
+    private:
+        conv_clip_polyline(const conv_clip_polyline<VertexSource>&);
+        const conv_clip_polyline<VertexSource>&
+            operator = (const conv_clip_polyline<VertexSource>&);
+
+        bool outside(const point_type& p) const
+        {
+            return p.x < m_vpgen.x1() || p.x > m_vpgen.x2() ||
+                   p.y < m_vpgen.y1() || p.y > m_vpgen.y2();
+        }
+
+        void load_contour();
+
+        VertexSource*         m_source;
+        vpgen_clip_polyline   m_vpgen;
+        pod_deque<point_type> m_vertices;
+        unsigned              m_first;
+        unsigned              m_feed;
+        unsigned              m_num_feed;
+        unsigned              m_end_cmd;
+        bool                  m_end_pending;
+        bool                  m_has_next;
+        point_type            m_next;
+    };
+
+
+    //------------------------------------------------------------------------
+    template<class VertexSource>
+    void conv_clip_polyline<VertexSource>::rewind(unsigned path_id)
+    {
+        m_source->rewind(path_id);
+        m_vpgen.reset();
+        m_vertices.remove_all();
+        m_first       = 0;
+        m_feed        = 0;
+        m_num_feed    = 0;
+        m_end_cmd     = path_cmd_stop;
+        m_end_pending = false;
+        m_has_next    = false;
+    }
+
+
+    //------------------------------------------------------------------------
+    // Reads one contour from the source. A closed contour that has a vertex
+    // outside the clip box is fed to the clipper starting from that vertex,
+    // so that the pieces cut from it all start and end on the box, and the
+    // joins at its first vertex are kept.
+    template<class VertexSource>
+    void conv_clip_polyline<VertexSource>::load_contour()
+    {
+        m_vertices.remove_all();
+        if(m_has_next)
+        {
+            m_vertices.add(m_next);
+            m_has_next = false;
+        }
+
+        m_end_pending = false;
+        for(;;)
+        {
+            double x, y;
+            unsigned cmd = m_source->vertex(&x, &y);
+            if(is_vertex(cmd))
+            {
+                if(is_move_to(cmd) && m_vertices.size())
+                {
+                    m_next = point_type(x, y);
+                    m_has_next = true;
+                    break;
+                }
+                m_vertices.add(point_type(x, y));
+            }
+            else
+            {
+                m_end_cmd = cmd;
+                m_end_pending = true;
+                break;
+            }
+        }
+
+        unsigned n = m_vertices.size();
+        bool closed = m_end_pending && is_end_poly(m_end_cmd) &&
+                      is_closed(m_end_cmd);
+        m_first = 0;
+        if(closed)
+        {
+            for(unsigned i = 0; i < n; i++)
+            {
+                if(outside(m_vertices[i]))
+                {
+                    m_first = i;
+                    break;
+                }
+            }
+        }
+        m_feed = 0;
+        m_num_feed = (n && closed) ? n + 1 : n;
+    }
+
+
+    //------------------------------------------------------------------------
+    template<class VertexSource>
+    unsigned conv_clip_polyline<VertexSource>::vertex(double* x, double* y)
+    {
+        unsigned cmd = path_cmd_stop;
+        for(;;)
+        {
+            cmd = m_vpgen.vertex(x, y);
+            if(!is_stop(cmd)) break;
+
+            if(m_feed < m_num_feed)
+            {
+                const point_type& p =
+                    m_vertices[(m_first + m_feed) % m_vertices.size()];
+                if(m_feed == 0) m_vpgen.move_to(p.x, p.y);
+                else            m_vpgen.line_to(p.x, p.y);
+                ++m_feed;
+                continue;
+            }
+
+            if(m_end_pending)
+            {
+                m_end_pending = false;
+                cmd = m_end_cmd;
+                if(is_end_poly(cmd))
+                {
+                    // A clipped contour can no longer be closed
+                    if(m_vpgen.clipped()) continue;
+                    break;
+                }
+                // The converter is transparent to all unknown commands
+                break;
+            }
+
+            load_contour();
+        }
+        return cmd;
+    }
+
+}
+
+#endif
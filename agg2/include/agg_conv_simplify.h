@@ -0,0 +1,158 @@
+//----------------------------------------------------------------------------
+// aggdraw addition to Anti-Grain Geometry 2.2; not part of the AGG
+// distribution.
+// Copyright (c) 2026 by AggDraw Developers
+//
+// Distributed under the aggdraw license; see LICENSE.txt.
+//
+//----------------------------------------------------------------------------
+//
+// Radial distance simplification. A vertex is dropped when it lies within
+// the tolerance of the last vertex that was kept, so the result never
+// strays from the source by more than the tolerance. The last vertex of
+// every subpath is always kept, and zero-length segments are always
+// dropped. Meant to be placed after the transform, with a tolerance in
+// device pixels.
+//
+//----------------------------------------------------------------------------
+#ifndef AGG_CONV_SIMPLIFY_INCLUDED
+#define AGG_CONV_SIMPLIFY_INCLUDED
+
+#include "agg_basics.h"
+#include "agg_vertex_iterator.h"
+
+namespace agg
+{
+
+    //===========================================================conv_simplify
+    template<class VertexSource> class conv_simplify
+    {
+    public:
+        conv_simplify(VertexSource& vs) :
+            m_source(&vs), m_tolerance(0.0), m_tolerance2(0.0) {}
+
+        void set_source(VertexSource& source) { m_source = &source; }
+
+        void tolerance(double t) { m_tolerance = t; m_tolerance2 = t * t; }
+        double tolerance() const { return m_tolerance; }
+
+        void rewind(unsigned path_id);
+        unsigned vertex(double* x, double* y);
+
+        typedef conv_simplify<VertexSource> source_type;
+        typedef vertex_iterator<source_type> iterator;
+        iterator begin(unsigned id) { return iterator(*this, id); }
+        iterator end() { return iterator(path_cmd_stop); }
+
+    private:
+        conv_simplify(const conv_simplify<VertexSource>&);
+        const conv_simplify<VertexSource>&
+            operator = (const conv_simplify<VertexSource>&);
+
+        // Queues the skipped vertex, if any, followed by the given command.
+        void flush(double x, double y, unsigned cmd);
+
+        VertexSource* m_source;
+        double        m_tolerance;
+        double        m_tolerance2;
+        double        m_last_x;
+        double        m_last_y;
+        double        m_skip_x;
+        double        m_skip_y;
+        bool          m_skipped;
+        unsigned      m_cmd[2];
+        double        m_x[2];
+        double        m_y[2];
+        unsigned      m_num_vertices;
+        unsigned      m_vertex;
+    };
+
+
+
+    //------------------------------------------------------------------------
+    template<class VertexSource>
+    void conv_simplify<VertexSource>::rewind(unsigned path_id)
+    {
+        m_source->rewind(path_id);
+        m_last_x = m_last_y = 0.0;
+        m_skipped = false;
+        m_num_vertices = 0;
+        m_vertex = 0;
+    }
+
+
+    //------------------------------------------------------------------------
+    template<class VertexSource>
+    void conv_simplify<VertexSource>::flush(double x, double y, unsigned cmd)
+    {
+        m_num_vertices = 0;
+        m_vertex = 0;
+        if(m_skipped)
+        {
+            m_x[0]   = m_skip_x;
+            m_y[0]   = m_skip_y;
+            m_cmd[0] = path_cmd_line_to;
+            m_num_vertices = 1;
+            m_skipped = false;
+        }
+        m_x[m_num_vertices]   = x;
+        m_y[m_num_vertices]   = y;
+        m_cmd[m_num_vertices] = cmd;
+        ++m_num_vertices;
+    }
+
+
+    //------------------------------------------------------------------------
+    template<class VertexSource>
+    unsigned conv_simplify<VertexSource>::vertex(double* x, double* y)
+    {
+        unsigned cmd;
+        for(;;)
+        {
+            if(m_vertex < m_num_vertices)
+            {
+                *x  = m_x[m_vertex];
+                *y  = m_y[m_vertex];
+                cmd = m_cmd[m_vertex];
+                ++m_vertex;
+                return cmd;
+            }
+
+            cmd = m_source->vertex(x, y);
+
+            if(is_move_to(cmd))
+            {
+                flush(*x, *y, cmd);
+                m_last_x = *x;
+                m_last_y = *y;
+                continue;
+            }
+
+            if(is_vertex(cmd))
+            {
+                double dx = *x - m_last_x;
+                double dy = *y - m_last_y;
+                double d2 = dx * dx + dy * dy;
+                if(d2 == 0.0) continue;
+                if(d2 <= m_tolerance2)
+                {
+                    m_skip_x = *x;
+                    m_skip_y = *y;
+                    m_skipped = true;
+                    continue;
+                }
+                m_skipped = false;
+                m_last_x = *x;
+                m_last_y = *y;
+                return cmd;
+            }
+
+            // end_poly, stop and anything else end the subpath, so the
+            // last skipped vertex goes out first
+            flush(*x, *y, cmd);
+        }
+    }
+
+}
+
+#endif
@@ -16,7 +16,9 @@
 #ifndef AGG_FONT_CACHE_MANAGER_INCLUDED
 #define AGG_FONT_CACHE_MANAGER_INCLUDED
 
+#include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "agg_array.h"
 
 namespace agg
@@ -45,6 +47,43 @@ namespace agg
     };
 
 
+    //-----------------------------------------------------glyph_cache_record
+    // Fixed-size glyph entry in a serialized font cache. The glyph data
+    // follows the records, each entry padded to 8 bytes.
+    struct glyph_cache_record
+    {
+        int32  glyph_code;
+        int32  phase;
+        int32  glyph_index;
+        int32  data_type;
+        int32  x1, y1, x2, y2;
+        int32  data_size;
+        int32  reserved;
+        double advance_x;
+        double advance_y;
+    };
+
+    //------------------------------------------------------------------------
+    enum glyph_cache_file_e
+    {
+        glyph_cache_version    = 2,
+        glyph_cache_byte_order = 0x01020304,
+        glyph_cache_stamp_size = 24
+    };
+
+    // Glyph data is used in place, in the layout of the code that wrote
+    // it, so cache files carry a stamp naming the AGG version, the cache
+    // format and the record and pointer sizes, followed by this string.
+    // An application defines it to add its own version; it is not tied
+    // to the build, so rebuilding keeps existing caches valid.
+#ifndef AGG_GLYPH_CACHE_STAMP
+#define AGG_GLYPH_CACHE_STAMP ""
+#endif
+
+    //------------------------------------------------------------------------
+    inline unsigned glyph_cache_align(unsigned size) { return (size + 7) & ~7u; }
+
+
     //--------------------------------------------------------------font_cache
     class font_cache
     {
@@ -52,9 +91,10 @@ namespace agg
         enum { block_size = 16384-16 };
 
         //--------------------------------------------------------------------
-        font_cache(const char* font_signature) : 
+        font_cache(const char* font_signature, unsigned num_phases=1) : 
             m_allocator(block_size),
-            m_font_signature(0)
+            m_font_signature(0),
+            m_num_phases(num_phases ? num_phases : 1)
         {
             m_font_signature = (char*)m_allocator.allocate(strlen(font_signature) + 1);
             strcpy(m_font_signature, font_signature);
@@ -68,12 +108,17 @@ namespace agg
         }
 
         //--------------------------------------------------------------------
-        const glyph_cache* find_glyph(unsigned glyph_code) const
+        unsigned num_phases() const { return m_num_phases; }
+
+        //--------------------------------------------------------------------
+        const glyph_cache* find_glyph(unsigned glyph_code, 
+                                      unsigned phase=0) const
         {
             unsigned msb = (glyph_code >> 8) & 0xFF;
             if(m_glyphs[msb]) 
             {
-                return m_glyphs[msb][glyph_code & 0xFF];
+                return m_glyphs[msb][(glyph_code & 0xFF) * m_num_phases + 
+                                     phase % m_num_phases];
             }
             return 0;
         }
@@ -85,18 +130,21 @@ namespace agg
                                  glyph_data_type data_type,
                                  const rect&     bounds,
                                  double          advance_x,
-                                 double          advance_y)
+                                 double          advance_y,
+                                 unsigned        phase=0)
         {
             unsigned msb = (glyph_code >> 8) & 0xFF;
             if(m_glyphs[msb] == 0)
             {
+                unsigned n = 256 * m_num_phases;
                 m_glyphs[msb] = 
-                    (glyph_cache**)m_allocator.allocate(sizeof(glyph_cache*) * 256, 
+                    (glyph_cache**)m_allocator.allocate(sizeof(glyph_cache*) * n, 
                                                         sizeof(glyph_cache*));
-                memset(m_glyphs[msb], 0, sizeof(glyph_cache*) * 256);
+                memset(m_glyphs[msb], 0, sizeof(glyph_cache*) * n);
             }
 
-            unsigned lsb = glyph_code & 0xFF;
+            unsigned lsb = (glyph_code & 0xFF) * m_num_phases + 
+                           phase % m_num_phases;
             if(m_glyphs[msb][lsb]) return 0; // Already exists, do not overwrite
 
             glyph_cache* glyph = 
@@ -113,10 +161,135 @@ namespace agg
             return m_glyphs[msb][lsb] = glyph;
         }
 
+        //--------------------------------------------------------------------
+        // Add a glyph whose data lives in memory owned by the caller (such
+        // as a mapped cache file), which must outlive this font_cache.
+        glyph_cache* cache_glyph_shared(unsigned        glyph_code, 
+                                        unsigned        phase,
+                                        const glyph_cache_record& rec,
+                                        const int8u*    data)
+        {
+            unsigned msb = (glyph_code >> 8) & 0xFF;
+            if(m_glyphs[msb] == 0)
+            {
+                unsigned n = 256 * m_num_phases;
+                m_glyphs[msb] = 
+                    (glyph_cache**)m_allocator.allocate(sizeof(glyph_cache*) * n, 
+                                                        sizeof(glyph_cache*));
+                memset(m_glyphs[msb], 0, sizeof(glyph_cache*) * n);
+            }
+
+            unsigned lsb = (glyph_code & 0xFF) * m_num_phases + 
+                           phase % m_num_phases;
+            if(m_glyphs[msb][lsb]) return 0;
+
+            glyph_cache* glyph = 
+                (glyph_cache*)m_allocator.allocate(sizeof(glyph_cache),
+                                                   sizeof(int8u*));
+            glyph->glyph_index = rec.glyph_index;
+            glyph->data        = (int8u*)data;
+            glyph->data_size   = rec.data_size;
+            glyph->data_type   = glyph_data_type(rec.data_type);
+            glyph->bounds      = rect(rec.x1, rec.y1, rec.x2, rec.y2);
+            glyph->advance_x   = rec.advance_x;
+            glyph->advance_y   = rec.advance_y;
+            return m_glyphs[msb][lsb] = glyph;
+        }
+
+        //--------------------------------------------------------------------
+        const char* signature() const { return m_font_signature; }
+
+        //--------------------------------------------------------------------
+        unsigned num_glyphs() const
+        {
+            unsigned i, j, n = 0;
+            for(i = 0; i < 256; i++)
+            {
+                if(m_glyphs[i] == 0) continue;
+                for(j = 0; j < 256 * m_num_phases; j++)
+                {
+                    if(m_glyphs[i][j]) ++n;
+                }
+            }
+            return n;
+        }
+
+        //--------------------------------------------------------------------
+        // Serialized layout: signature length, signature (8-aligned),
+        // glyph count, glyph records, glyph data.
+        unsigned byte_size() const
+        {
+            unsigned i, j;
+            unsigned size = 8 + glyph_cache_align(strlen(m_font_signature) + 1) + 8;
+            for(i = 0; i < 256; i++)
+            {
+                if(m_glyphs[i] == 0) continue;
+                for(j = 0; j < 256 * m_num_phases; j++)
+                {
+                    const glyph_cache* gl = m_glyphs[i][j];
+                    if(gl == 0) continue;
+                    size += sizeof(glyph_cache_record) + 
+                            glyph_cache_align(gl->data_size);
+                }
+            }
+            return size;
+        }
+
+        //--------------------------------------------------------------------
+        int8u* serialize(int8u* ptr) const
+        {
+            int32 n = int32(strlen(m_font_signature) + 1);
+            memset(ptr, 0, 8);
+            memcpy(ptr, &n, sizeof(n));
+            ptr += 8;
+            memset(ptr, 0, glyph_cache_align(n));
+            memcpy(ptr, m_font_signature, n);
+            ptr += glyph_cache_align(n);
+
+            n = int32(num_glyphs());
+            memset(ptr, 0, 8);
+            memcpy(ptr, &n, sizeof(n));
+            ptr += 8;
+
+            int8u* data = ptr + n * sizeof(glyph_cache_record);
+            unsigned i, j;
+            for(i = 0; i < 256; i++)
+            {
+                if(m_glyphs[i] == 0) continue;
+                for(j = 0; j < 256 * m_num_phases; j++)
+                {
+                    const glyph_cache* gl = m_glyphs[i][j];
+                    if(gl == 0) continue;
+                    glyph_cache_record rec;
+                    rec.glyph_code  = int32((i << 8) | (j / m_num_phases));
+                    rec.phase       = int32(j % m_num_phases);
+                    rec.glyph_index = int32(gl->glyph_index);
+                    rec.data_type   = int32(gl->data_type);
+                    rec.x1          = gl->bounds.x1;
+                    rec.y1          = gl->bounds.y1;
+                    rec.x2          = gl->bounds.x2;
+                    rec.y2          = gl->bounds.y2;
+                    rec.data_size   = int32(gl->data_size);
+                    rec.reserved    = 0;
+                    rec.advance_x   = gl->advance_x;
+                    rec.advance_y   = gl->advance_y;
+                    memcpy(ptr, &rec, sizeof(rec));
+                    ptr += sizeof(rec);
+
+                    unsigned size = glyph_cache_align(gl->data_size);
+                    memset(data, 0, size);
+                    if(gl->data_size) memcpy(data, gl->data, gl->data_size);
+                    data += size;
+                }
+            }
+            return data;
+        }
+
     private:
         pod_allocator   m_allocator;
         glyph_cache**   m_glyphs[256];
         char*           m_font_signature;
+        unsigned        m_num_phases;
     };
 
 
@@ -125,6 +298,61 @@ namespace agg
 
 
     
+    //------------------------------------------------serialized_scanlines_valid
+    // aggdraw: checks serialized scanline_storage_aa8 (aa) or
+    // scanline_storage_bin data before it is replayed: every scanline lies
+    // within the bounds, and its spans are in order, do not overlap and
+    // stay within the data.
+    inline bool serialized_scanlines_valid(const int8u* data, unsigned size, 
+                                           bool aa)
+    {
+        if(size == 0) return true;
+        if(size < 8) return false;
+
+        int16 v[4];
+        memcpy(v, data, sizeof(v));
+        if(v[0] > v[2] || v[1] > v[3]) return false;
+
+        const int8u* p = data + 8;
+        const int8u* end = data + size;
+        while(p < end)
+        {
+            // [size,] y, number of spans
+            int16 head[3];
+            unsigned head_size = aa ? 3 * sizeof(int16) : 2 * sizeof(int16);
+            if(unsigned(end - p) < head_size) return false;
+            memcpy(head, p, head_size);
+            int y = aa ? head[1] : head[0];
+            int num_spans = aa ? head[2] : head[1];
+            if(y < v[1] || y > v[3] || num_spans <= 0) return false;
+
+            const int8u* q = p + head_size;
+            int next = v[0];
+            int i;
+            for(i = 0; i < num_spans; i++)
+            {
+                // x, length (negative for a solid span)
+                int16 span[2];
+                if(unsigned(end - q) < sizeof(span)) return false;
+                memcpy(span, q, sizeof(span));
+                q += sizeof(span);
+                int len = span[1] < 0 ? -span[1] : span[1];
+                int covers = aa ? (span[1] < 0 ? 1 : span[1]) : 0;
+                if(len == 0 || span[0] < next || span[0] + len - 1 > v[2] ||
+                   (end - q) < covers)
+                {
+                    return false;
+                }
+                next = span[0] + len;
+                q += covers;
+            }
+            if(aa && int16u(q - p) != int16u(head[0])) return false;
+            p = q;
+        }
+        return true;
+    }
+
+
     //---------------------------------------------------------font_cache_pool
     class font_cache_pool
     {
@@ -141,10 +369,11 @@ namespace agg
         }
 
         //--------------------------------------------------------------------
-        font_cache_pool(unsigned max_fonts=32) : 
+        font_cache_pool(unsigned max_fonts=32, unsigned num_phases=1) : 
             m_fonts(new font_cache* [max_fonts]),
             m_max_fonts(max_fonts),
             m_num_fonts(0),
+            m_num_phases(num_phases),
             m_cur_font(0)
         {}
 
@@ -158,7 +387,7 @@ namespace agg
                 if(reset_cache)
                 {
                     delete m_fonts[idx];
-                    m_fonts[idx] = new font_cache(font_signature);
+                    m_fonts[idx] = new font_cache(font_signature, m_num_phases);
                 }
                 m_cur_font = m_fonts[idx];
             }
@@ -172,7 +401,7 @@ namespace agg
                            (m_max_fonts - 1) * sizeof(font_cache*));
                     m_num_fonts = m_max_fonts - 1;
                 }
-                m_fonts[m_num_fonts] = new font_cache(font_signature);
+                m_fonts[m_num_fonts] = new font_cache(font_signature, m_num_phases);
                 m_cur_font = m_fonts[m_num_fonts];
                 ++m_num_fonts;
             }
@@ -185,9 +414,10 @@ namespace agg
         }
 
         //--------------------------------------------------------------------
-        const glyph_cache* find_glyph(unsigned glyph_code) const
+        const glyph_cache* find_glyph(unsigned glyph_code, 
+                                      unsigned phase=0) const
         {
-            if(m_cur_font) return m_cur_font->find_glyph(glyph_code);
+            if(m_cur_font) return m_cur_font->find_glyph(glyph_code, phase);
             return 0;
         }
 
@@ -198,7 +428,8 @@ namespace agg
                                  glyph_data_type data_type,
                                  const rect&     bounds,
                                  double          advance_x,
-                                 double          advance_y)
+                                 double          advance_y,
+                                 unsigned        phase=0)
         {
             if(m_cur_font) 
             {
@@ -208,12 +439,164 @@ namespace agg
                                                data_type,
                                                bounds,
                                                advance_x,
-                                               advance_y);
+                                               advance_y,
+                                               phase);
             }
             return 0;
         }
 
 
+        //--------------------------------------------------------------------
+        // Serialized layout: "AGGGLYPH", version, byte order, number of
+        // subpixel phases, number of fonts, record size, pointer size, the
+        // build stamp, then each font_cache.
+        unsigned byte_size() const
+        {
+            unsigned i, size = 8 + 6 * sizeof(int32) + glyph_cache_stamp_size;
+            for(i = 0; i < m_num_fonts; i++) size += m_fonts[i]->byte_size();
+            return size;
+        }
+
+        //--------------------------------------------------------------------
+        void serialize(int8u* ptr) const
+        {
+            int32 header[6] = { glyph_cache_version, 
+                                glyph_cache_byte_order,
+                                int32(m_num_phases),
+                                int32(m_num_fonts),
+                                int32(sizeof(glyph_cache_record)),
+                                int32(sizeof(void*)) };
+            memcpy(ptr, "AGGGLYPH", 8);
+            memcpy(ptr + 8, header, sizeof(header));
+            ptr += 8 + sizeof(header);
+            make_stamp((char*)ptr);
+            ptr += glyph_cache_stamp_size;
+            unsigned i;
+            for(i = 0; i < m_num_fonts; i++) ptr = m_fonts[i]->serialize(ptr);
+        }
+
+        //--------------------------------------------------------------------
+        // Add the fonts from serialized cache data. Glyph data is used in
+        // place, so the memory must stay valid for the lifetime of the
+        // pool. Fonts that are already cached are left alone. Returns the
+        // number of fonts added, or -1 if the data is not valid.
+        //
+        // aggdraw: all sizes are checked as unsigned against the bytes
+        // left, and the glyph scanlines are checked before they are used.
+        int deserialize(const int8u* data, unsigned size)
+        {
+            const int8u* end = data + size;
+            int32 header[6];
+            char stamp[glyph_cache_stamp_size];
+            make_stamp(stamp);
+            if(size < 8 + sizeof(header) + sizeof(stamp) || 
+               memcmp(data, "AGGGLYPH", 8) != 0) 
+            {
+                return -1;
+            }
+            memcpy(header, data + 8, sizeof(header));
+            if(header[0] != glyph_cache_version || 
+               header[1] != glyph_cache_byte_order ||
+               header[2] != int32(m_num_phases) ||
+               header[3] < 0 ||
+               header[4] != int32(sizeof(glyph_cache_record)) ||
+               header[5] != int32(sizeof(void*)) ||
+               memcmp(data + 8 + sizeof(header), stamp, sizeof(stamp)) != 0)
+            {
+                return -1;
+            }
+            // The first pass only validates, so that a damaged file
+            // never leaves half of its fonts in the pool.
+            int pass, added = 0;
+            for(pass = 0; pass < 2; pass++)
+            {
+                const int8u* ptr = data + 8 + sizeof(header) + sizeof(stamp);
+                int32 f, n;
+                unsigned g, len;
+                for(f = 0; f < header[3]; f++)
+                {
+                    if(unsigned(end - ptr) < 8) return -1;
+                    memcpy(&n, ptr, sizeof(n));
+                    ptr += 8;
+                    len = unsigned(n);
+                    if(n <= 0 || 
+                       unsigned(end - ptr) < len ||
+                       unsigned(end - ptr) < glyph_cache_align(len) ||
+                       ptr[len - 1]) 
+                    {
+                        return -1;
+                    }
+                    const char* signature = (const char*)ptr;
+                    ptr += glyph_cache_align(len);
+
+                    if(unsigned(end - ptr) < 8) return -1;
+                    memcpy(&n, ptr, sizeof(n));
+                    ptr += 8;
+                    len = unsigned(n);
+                    if(n < 0 || 
+                       unsigned(end - ptr) / sizeof(glyph_cache_record) < len)
+                    {
+                        return -1;
+                    }
+                    const int8u* records = ptr;
+                    ptr += len * sizeof(glyph_cache_record);
+
+                    font_cache* fc = 0;
+                    if(pass == 1 && find_font(signature) < 0)
+                    {
+                        font(signature);
+                        fc = m_cur_font;
+                        ++added;
+                    }
+                    for(g = 0; g < len; g++)
+                    {
+                        glyph_cache_record rec;
+                        memcpy(&rec, records + g * sizeof(rec), sizeof(rec));
+                        unsigned data_size = unsigned(rec.data_size);
+                        if(rec.data_size < 0 || 
+                           unsigned(end - ptr) < data_size ||
+                           unsigned(end - ptr) < glyph_cache_align(data_size) ||
+                           !glyph_record_valid(rec, ptr))
+                        {
+                            return -1;
+                        }
+                        if(fc)
+                        {
+                            fc->cache_glyph_shared(unsigned(rec.glyph_code), 
+                                                   unsigned(rec.phase), 
+                                                   rec, ptr);
+                        }
+                        ptr += glyph_cache_align(data_size);
+                    }
+                }
+            }
+            m_cur_font = 0;
+            return added;
+        }
+
+        //--------------------------------------------------------------------
+        // aggdraw: checks a glyph record and its data, which holds
+        // serialized scanlines for mono and gray8 glyphs, and serialized
+        // integer vertices for outlines.
+        bool glyph_record_valid(const glyph_cache_record& rec,
+                                const int8u* data) const
+        {
+            if(rec.phase < 0 || rec.phase >= int32(m_num_phases)) return false;
+            switch(rec.data_type)
+            {
+            case glyph_data_mono:
+                return serialized_scanlines_valid(data, rec.data_size, false);
+            case glyph_data_gray8:
+                return serialized_scanlines_valid(data, rec.data_size, true);
+            case glyph_data_outline:
+                // Vertices are 4 or 8 bytes; reading the last one stays
+                // within the padding to 8 bytes
+                return rec.data_size % 4 == 0;
+            default:
+                return false;
+            }
+        }
+
         //--------------------------------------------------------------------
         int find_font(const char* font_signature)
         {
@@ -226,9 +609,25 @@ namespace agg
         }
 
     private:
+        //--------------------------------------------------------------------
+        static void make_stamp(char* stamp)
+        {
+            char buf[64];
+            sprintf(buf, "agg2.2/%d/%u/%u/", 
+                    int(glyph_cache_version), 
+                    unsigned(sizeof(glyph_cache_record)), 
+                    unsigned(sizeof(void*)));
+            strncat(buf, AGG_GLYPH_CACHE_STAMP, sizeof(buf) - strlen(buf) - 1);
+            unsigned len = unsigned(strlen(buf));
+            if(len > glyph_cache_stamp_size - 1) len = glyph_cache_stamp_size - 1;
+            memset(stamp, 0, glyph_cache_stamp_size);
+            memcpy(stamp, buf, len);
+        }
+
         font_cache** m_fonts;
         unsigned     m_max_fonts;
         unsigned     m_num_fonts;
+        unsigned     m_num_phases;
         font_cache*  m_cur_font;
     };
 
@@ -242,7 +641,8 @@ namespace agg
         glyph_ren_native_gray8,
         glyph_ren_outline,
         glyph_ren_agg_mono,
-        glyph_ren_agg_gray8
+        glyph_ren_agg_gray8,
+        glyph_ren_outline_flat
     };
 
 
@@ -260,20 +660,29 @@ namespace agg
         typedef typename font_engine_type::mono_adaptor_type   mono_adaptor_type;
         typedef typename mono_adaptor_type::embedded_scanline  mono_scanline_type;
 
+        // With subpixel_phases > 1, bitmap glyphs are cached once per
+        // horizontal subpixel phase, so that text placed at fractional
+        // x positions can still be rendered from the bitmap cache.
         //--------------------------------------------------------------------
-        font_cache_manager(font_engine_type& engine, unsigned max_fonts=32) :
-            m_fonts(max_fonts),
+        font_cache_manager(font_engine_type& engine, unsigned max_fonts=32,
+                           unsigned subpixel_phases=1) :
+            m_fonts(max_fonts, subpixel_phases ? subpixel_phases : 1),
             m_engine(engine),
             m_change_stamp(-1),
+            m_subpixel_phases(subpixel_phases ? subpixel_phases : 1),
             m_prev_glyph(0),
             m_last_glyph(0)
         {}
 
         //--------------------------------------------------------------------
-        const glyph_cache* glyph(unsigned glyph_code)
+        unsigned subpixel_phases() const { return m_subpixel_phases; }
+
+        //--------------------------------------------------------------------
+        const glyph_cache* glyph(unsigned glyph_code, unsigned phase=0)
         {
             synchronize();
-            const glyph_cache* gl = m_fonts.find_glyph(glyph_code);
+            phase %= m_subpixel_phases;
+            const glyph_cache* gl = m_fonts.find_glyph(glyph_code, phase);
             if(gl) 
             {
                 m_prev_glyph = m_last_glyph;
@@ -281,7 +690,8 @@ namespace agg
             }
             else
             {
-                if(m_engine.prepare_glyph(glyph_code))
+                if(m_engine.prepare_glyph(glyph_code, 
+                                          double(phase) / m_subpixel_phases))
                 {
                     m_prev_glyph = m_last_glyph;
                     m_last_glyph = m_fonts.cache_glyph(glyph_code, 
@@ -290,7 +700,8 @@ namespace agg
                                                        m_engine.data_type(),
                                                        m_engine.bounds(),
                                                        m_engine.advance_x(),
-                                                       m_engine.advance_y());
+                                                       m_engine.advance_y(),
+                                                       phase);
                     m_engine.write_glyph_to(m_last_glyph->data);
                     return m_last_glyph;
                 }
@@ -298,6 +709,22 @@ namespace agg
             return 0;
         }
 
+        // Split x into an integer origin and the subpixel phase that
+        // best approximates the fractional part.
+        //--------------------------------------------------------------------
+        unsigned subpixel_phase(double* x) const
+        {
+            double ix = floor(*x);
+            unsigned phase = unsigned((*x - ix) * m_subpixel_phases + 0.5);
+            if(phase >= m_subpixel_phases)
+            {
+                phase = 0;
+                ix += 1.0;
+            }
+            *x = ix;
+            return phase;
+        }
+
         //--------------------------------------------------------------------
         void init_embedded_adaptors(const glyph_cache* gl, double x, double y)
         {
@@ -350,6 +777,19 @@ namespace agg
             for(; from <= to; ++from) glyph(from);
         }
 
+        //--------------------------------------------------------------------
+        // Persistent caches: serialize all cached glyphs, or add glyphs
+        // from serialized data that the caller keeps alive (e.g. mmap).
+        unsigned cache_byte_size() const { return m_fonts.byte_size(); }
+        void     save_cache(int8u* data) const { m_fonts.serialize(data); }
+        int      load_cache(const int8u* data, unsigned size)
+        {
+            int added = m_fonts.deserialize(data, size);
+            m_change_stamp = -1;
+            m_prev_glyph = m_last_glyph = 0;
+            return added;
+        }
+
         //--------------------------------------------------------------------
         void reset_cache()
         {
@@ -377,6 +817,7 @@ namespace agg
         font_cache_pool     m_fonts;
         font_engine_type&   m_engine;
         int                 m_change_stamp;
+        unsigned            m_subpixel_phases;
         double              m_dx;
         double              m_dy;
         const glyph_cache*  m_prev_glyph;
@@ -0,0 +1,115 @@
+//----------------------------------------------------------------------------
+// aggdraw addition to Anti-Grain Geometry 2.2; not part of the AGG
+// distribution.
+// Copyright (c) 2026 by AggDraw Developers
+//
+// Distributed under the aggdraw license; see LICENSE.txt.
+//
+//----------------------------------------------------------------------------
+//
+// path_storage_float: a compact vertex container for paths that are built
+// once and drawn many times. Coordinates are kept in single precision and
+// commands in a separate byte array, which takes 9 bytes per vertex
+// instead of the 17 used by path_storage. Unlike path_storage_integer,
+// commands and end_poly flags are kept exactly, so open and closed
+// contours behave the same as in path_storage.
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_PATH_STORAGE_FLOAT_INCLUDED
+#define AGG_PATH_STORAGE_FLOAT_INCLUDED
+
+#include "agg_basics.h"
+#include "agg_array.h"
+
+namespace agg
+{
+
+    //-----------------------------------------------------------vertex_float
+    struct vertex_float
+    {
+        float x, y;
+
+        vertex_float() {}
+        vertex_float(double x_, double y_) : x(float(x_)), y(float(y_)) {}
+    };
+
+
+    //-----------------------------------------------------path_storage_float
+    class path_storage_float
+    {
+    public:
+        //--------------------------------------------------------------------
+        path_storage_float() : m_vertices(), m_cmds(), m_iterator(0) {}
+
+        //--------------------------------------------------------------------
+        void remove_all()
+        {
+            m_vertices.remove_all();
+            m_cmds.remove_all();
+            m_iterator = 0;
+        }
+
+        //--------------------------------------------------------------------
+        void add_vertex(double x, double y, unsigned cmd)
+        {
+            m_vertices.add(vertex_float(x, y));
+            m_cmds.add(int8u(cmd));
+        }
+
+        //--------------------------------------------------------------------
+        // Copies all vertices of the source as they are, including curve
+        // control points and end_poly commands.
+        template<class VertexSource> void add_path(VertexSource& vs,
+                                                   unsigned path_id = 0)
+        {
+            double x, y;
+            unsigned cmd;
+            vs.rewind(path_id);
+            while(!is_stop(cmd = vs.vertex(&x, &y)))
+            {
+                add_vertex(x, y, cmd);
+            }
+        }
+
+        //--------------------------------------------------------------------
+        unsigned total_vertices() const { return m_cmds.size(); }
+        unsigned byte_size() const
+        {
+            return m_vertices.size() * sizeof(vertex_float) + m_cmds.size();
+        }
+
+        //--------------------------------------------------------------------
+        unsigned vertex(unsigned idx, double* x, double* y) const
+        {
+            const vertex_float& v = m_vertices[idx];
+            *x = v.x;
+            *y = v.y;
+            return m_cmds[idx];
+        }
+
+        //--------------------------------------------------------------------
+        void modify_vertex(unsigned idx, double x, double y)
+        {
+            m_vertices[idx] = vertex_float(x, y);
+        }
+
+        //--------------------------------------------------------------------
+        void rewind(unsigned path_id) { m_iterator = path_id; }
+
+        //--------------------------------------------------------------------
+        unsigned vertex(double* x, double* y)
+        {
+            if(m_iterator >= m_cmds.size()) return path_cmd_stop;
+            return vertex(m_iterator++, x, y);
+        }
+
+    private:
+        pod_deque<vertex_float, 8> m_vertices;
+        pod_deque<int8u, 8>        m_cmds;
+        unsigned                   m_iterator;
+    };
+
+}
+
+#endif
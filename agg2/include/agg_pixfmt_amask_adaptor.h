@@ -44,12 +44,13 @@ namespace agg
             }
         }
 
-        void init_span(unsigned len)
+        // aggdraw: takes the cover, for blend_hline and blend_vline
+        void init_span(unsigned len, cover_type cover = amask_type::cover_full)
         {
             realloc_span(len);
 
             // ATTN! May work incorrectly if cover_type is more that one byte
-            memset(m_span, amask_type::cover_full, len * sizeof(cover_type));
+            memset(m_span, cover, len * sizeof(cover_type));
         }
 
         void init_span(unsigned len, const cover_type* covers)
@@ -107,7 +108,8 @@ namespace agg
                          const color_type& c,
                          cover_type cover)
         {
-            init_span(len);
+            // aggdraw: the cover was ignored here
+            init_span(len, cover);
             m_mask->combine_hspan(x, y, m_span, len);
             m_pixf->blend_solid_hspan(x, y, len, c, m_span);
         }
@@ -128,7 +130,8 @@ namespace agg
                          const color_type& c,
                          cover_type cover)
         {
-            init_span(len);
+            // aggdraw: the cover was ignored here
+            init_span(len, cover);
             m_mask->combine_vspan(x, y, m_span, len);
             m_pixf->blend_solid_vspan(x, y, len, c, m_span);
         }
@@ -846,8 +846,10 @@ namespace agg
         unsigned num1 = sl1.num_spans();
         unsigned num2 = sl2.num_spans();
 
-        typename Scanline::const_iterator span1;
-        typename Scanline::const_iterator span2;
+        // aggdraw: initialized as in sbool_intersect_scanlines, which keeps
+        // GCC from warning that they may be used uninitialized
+        typename Scanline::const_iterator span1 = sl1.begin();
+        typename Scanline::const_iterator span2 = sl2.begin();
 
         enum { invalid_b = 0x7FFFFFFF, invalid_e = invalid_b - 1 };
 
@@ -308,7 +308,8 @@ namespace agg
                                        unsigned(abs(int(sp.len))));
                 m_spans.add(sp);
                 int x1 = sp.x;
-                int x2 = sp.x + sp.len - 1;
+                // aggdraw: solid spans have a negative length
+                int x2 = sp.x + abs(int(sp.len)) - 1;
                 if(x1 < m_min_x) m_min_x = x1;
                 if(x2 > m_max_x) m_max_x = x2;
                 ++span_iterator;
@@ -0,0 +1,147 @@
+//----------------------------------------------------------------------------
+// aggdraw addition to Anti-Grain Geometry 2.2; not part of the AGG
+// distribution.
+// Copyright (c) 2026 by AggDraw Developers
+//
+// Distributed under the aggdraw license; see LICENSE.txt.
+//
+//----------------------------------------------------------------------------
+//
+// span_sdf: solid color spans whose alpha is taken from a signed distance
+// field (one byte per pixel, 128 on the edge, larger values inside).
+// The distance field is sampled through a span interpolator, so one field
+// can be rendered at any scale or rotation.
+//
+//----------------------------------------------------------------------------
+
+#ifndef AGG_SPAN_SDF_INCLUDED
+#define AGG_SPAN_SDF_INCLUDED
+
+#include "agg_basics.h"
+#include "agg_rendering_buffer.h"
+#include "agg_span_generator.h"
+
+namespace agg
+{
+
+    //----------------------------------------------------------------span_sdf
+    template<class ColorT,
+             class Interpolator,
+             class Allocator = span_allocator<ColorT> >
+    class span_sdf : public span_generator<ColorT, Allocator>
+    {
+    public:
+        typedef ColorT color_type;
+        typedef Interpolator interpolator_type;
+        typedef Allocator alloc_type;
+        typedef span_generator<color_type, alloc_type> base_type;
+
+        enum
+        {
+            base_shift = 8,
+            base_size  = 1 << base_shift,
+            base_mask  = base_size - 1,
+            edge_value = 128
+        };
+
+        //--------------------------------------------------------------------
+        span_sdf(alloc_type& alloc,
+                 const rendering_buffer& src,
+                 interpolator_type& inter) :
+            base_type(alloc),
+            m_src(&src),
+            m_interpolator(&inter),
+            m_x1(0), m_y1(0),
+            m_x2(int(src.width()) - 1), m_y2(int(src.height()) - 1),
+            m_smooth(base_size * 16)
+        {}
+
+        //--------------------------------------------------------------------
+        void color(const color_type& c) { m_color = c; }
+        const color_type& color() const { return m_color; }
+
+        //--------------------------------------------------------------------
+        void interpolator(interpolator_type& i) { m_interpolator = &i; }
+        interpolator_type& interpolator() { return *m_interpolator; }
+
+        //--------------------------------------------------------------------
+        // Restrict sampling to a sub-rectangle of the source (inclusive),
+        // so that neighbouring entries of an atlas never bleed in.
+        void clip(int x1, int y1, int x2, int y2)
+        {
+            m_x1 = x1; m_y1 = y1;
+            m_x2 = x2; m_y2 = y2;
+        }
+
+        //--------------------------------------------------------------------
+        // Half width of the anti-aliasing ramp, in distance field units
+        // (1/256 of a byte value).
+        void smoothing(double s)
+        {
+            m_smooth = int(s * base_size + 0.5);
+            if(m_smooth < 1) m_smooth = 1;
+        }
+
+        //--------------------------------------------------------------------
+        color_type* generate(int x, int y, unsigned len)
+        {
+            m_interpolator->begin(x + 0.5, y + 0.5, len);
+            color_type* span = base_type::allocator().span();
+            do
+            {
+                int sx;
+                int sy;
+                m_interpolator->coordinates(&sx, &sy);
+                sx -= interpolator_type::subpixel_size / 2;
+                sy -= interpolator_type::subpixel_size / 2;
+
+                int d = sample(sx, sy) - edge_value * base_size;
+                int a;
+                if(d <= -m_smooth)     a = 0;
+                else if(d >= m_smooth) a = 255;
+                else a = (d + m_smooth) * 255 / (2 * m_smooth);
+
+                *span = m_color;
+                span->a = int8u((m_color.a * a + 255) >> 8);
+                ++span;
+                ++(*m_interpolator);
+            }
+            while(--len);
+            return base_type::allocator().span();
+        }
+
+    private:
+        //--------------------------------------------------------------------
+        int pixel(int x, int y) const
+        {
+            if(x < m_x1) x = m_x1; else if(x > m_x2) x = m_x2;
+            if(y < m_y1) y = m_y1; else if(y > m_y2) y = m_y2;
+            return m_src->row(y)[x];
+        }
+
+        //--------------------------------------------------------------------
+        // Bilinear sample, returns the field value scaled by base_size.
+        int sample(int sx, int sy) const
+        {
+            int x = sx >> interpolator_type::subpixel_shift;
+            int y = sy >> interpolator_type::subpixel_shift;
+            int fx = (sx >> (interpolator_type::subpixel_shift - base_shift)) & base_mask;
+            int fy = (sy >> (interpolator_type::subpixel_shift - base_shift)) & base_mask;
+            int top = pixel(x, y)     * (base_size - fx) + pixel(x + 1, y)     * fx;
+            int bot = pixel(x, y + 1) * (base_size - fx) + pixel(x + 1, y + 1) * fx;
+            return (top * (base_size - fy) + bot * fy) >> base_shift;
+        }
+
+        const rendering_buffer* m_src;
+        interpolator_type*      m_interpolator;
+        color_type              m_color;
+        int                     m_x1;
+        int                     m_y1;
+        int                     m_x2;
+        int                     m_y2;
+        int                     m_smooth;
+    };
+
+}
+
+#endif
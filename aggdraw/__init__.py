@@ -1,6 +1,10 @@
-from .core import Draw, Pen, Brush, Path, Symbol, Font
+from .core import Draw, Pen, Brush, Path, PathGroup, Symbol, Font, RasterFont
+from .core import Coverage
+from .core import save_glyph_cache, load_glyph_cache
 
-__all__ = ["Pen", "Brush", "Font", "Path", "Symbol", "Draw"]
+__all__ = ["Pen", "Brush", "Font", "RasterFont", "Path", "PathGroup",
+           "Symbol", "Coverage", "Draw", "save_glyph_cache",
+           "load_glyph_cache"]
 
 VERSION = "1.4.1"
 __version__ = VERSION
@@ -49,9 +49,20 @@
 #define Q(x) #x
 #define QUOTE(x) Q(x)
 
+/* glyph cache files name the aggdraw version that wrote them */
+#define AGG_GLYPH_CACHE_STAMP QUOTE(VERSION)
+
 #if defined(_MSC_VER)
 #define WINDOWS_LEAN_AND_MEAN
 #include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #ifndef M_PI
@@ -76,24 +87,42 @@
 
 /* agg2 components */
 #include "agg_arc.h"
+#include "agg_array.h"
+#include "agg_bounding_rect.h"
+#include "agg_conv_clip_polygon.h"
+#include "agg_conv_clip_polyline.h"
+#include "agg_conv_close_polygon.h"
 #include "agg_conv_contour.h"
 #include "agg_conv_curve.h"
+#include "agg_conv_simplify.h"
 // #include "agg_conv_dash.h"
 #include "agg_conv_stroke.h"
 #include "agg_conv_transform.h"
 #include "agg_ellipse.h"
+#include "agg_embedded_raster_fonts.h"
+#include "agg_glyph_raster_bin.h"
 #include "agg_rounded_rect.h"
 #if defined(HAVE_FREETYPE2)
 #include "agg_font_freetype.h"
+#include "agg_font_sdf.h"
+#include "agg_span_interpolator_linear.h"
+#include "agg_span_sdf.h"
 #endif
 #include "agg_path_storage.h"
+#include "agg_path_storage_float.h"
 #include "agg_pixfmt_gray8.h"
 #include "agg_pixfmt_rgb24.h"
 #include "agg_pixfmt_rgba32.h"
 #include "agg_rasterizer_scanline_aa.h"
+#include "agg_alpha_mask_u8.h"
+#include "agg_pixfmt_amask_adaptor.h"
+#include "agg_renderer_mclip.h"
+#include "agg_renderer_raster_text.h"
 #include "agg_renderer_scanline.h"
 #include "agg_rendering_buffer.h"
+#include "agg_scanline_boolean_algebra.h"
 #include "agg_scanline_p.h"
+#include "agg_scanline_storage_aa.h"
 #include "platform/agg_platform_support.h" // agg::pix_format_*
 
 /* -------------------------------------------------------------------- */
@@ -103,12 +132,42 @@
 typedef agg::font_engine_freetype_int32 font_engine_type;
 typedef agg::font_cache_manager<font_engine_type> font_manager_type;
 
+/* number of horizontal subpixel positions cached per bitmap glyph */
+#define GLYPH_SUBPIXEL_PHASES 4
+
 static font_engine_type font_engine;
-static font_manager_type font_manager(font_engine);
+static font_manager_type font_manager(font_engine, 32, GLYPH_SUBPIXEL_PHASES);
+
+/* signed distance field atlases, shared by all sizes of a font file */
+#define MAX_SDF_ATLASES 32
+
+static agg::font_sdf_atlas* sdf_atlases[MAX_SDF_ATLASES];
+static int sdf_atlas_count = 0;
+
+/* font data supplied as a buffer object, shared by all fonts that are
+   created from the same bytes */
+typedef struct font_source {
+    char* key; /* pool key for faces, atlases and glyph caches */
+    Py_buffer view;
+    int refcount;
+    struct font_source* next;
+} font_source;
+
+static font_source* font_sources = NULL;
+
+#ifdef Py_GIL_DISABLED
+static PyMutex font_source_mutex;
+#define FONT_SOURCE_LOCK() PyMutex_Lock(&font_source_mutex)
+#define FONT_SOURCE_UNLOCK() PyMutex_Unlock(&font_source_mutex)
+#else
+#define FONT_SOURCE_LOCK()
+#define FONT_SOURCE_UNLOCK()
+#endif
 #endif
 
 /* forward declaration */
 class draw_adaptor_base;
+struct PointF;
 
 template<class PixFmt> class draw_adaptor;
 
@@ -117,6 +176,16 @@ typedef struct {
     draw_adaptor_base *draw;
     agg::rendering_buffer* buffer;
     agg::trans_affine* transform;
+    double tolerance; /* curve flattening tolerance, relative */
+    double simplify; /* simplification tolerance, in pixels (0=off) */
+    agg::pod_deque<agg::rect, 2>* clips; /* clip region, as a union of
+                                            inclusive device boxes */
+    agg::rect clip; /* bounds of the clip region (invalid if empty) */
+    agg::path_storage* scratch; /* reused by the shape drawing methods */
+    agg::rendering_buffer* mask; /* gray8 alpha mask (NULL if none) */
+    unsigned char* mask_data;
+    PointF* points; /* reused by getpoints */
+    int points_size;
     unsigned char* buffer_data;
     int mode; // agg::pix_format_*
     int xsize, ysize;
@@ -129,7 +198,31 @@ typedef struct {
     #define Py_TYPE(ob) (((PyObject*)(ob))->ob_type)
 #endif
 
-/* glue functions (see the init function for details) */
+/* approximation scale for curves, arcs and round joins drawn on this
+   surface. curves are flattened in user space, so the scale follows the
+   transform; a shape shrunk to a few pixels gets a few vertices */
+static double
+draw_approximation_scale(DrawObject* self)
+{
+    double scale = self->transform ? self->transform->scale() : 1.0;
+    scale /= self->tolerance;
+    return (scale < 1e-3) ? 1e-3 : scale;
+}
+
+/* returns an empty path for building a shape to draw. the path is kept
+   by the drawing object and reset rather than freed, so once its blocks
+   have been allocated, drawing shapes does not touch the heap */
+static agg::path_storage&
+draw_scratch(DrawObject* self)
+{
+    if (!self->scratch)
+        self->scratch = new agg::path_storage();
+    else
+        self->scratch->remove_all();
+    return *self->scratch;
+}
+
+/* glue functions (see getcolor_fallback for details) */
 static PyObject* aggdraw_getcolor_obj;
 
 static void draw_dealloc(DrawObject* self);
@@ -234,13 +327,18 @@ static PyTypeObject BrushType = {
 
 typedef struct {
     PyObject_HEAD
-    char* filename;
+    char* filename; /* file name, or the source key for memory fonts */
+    struct font_source* source; /* NULL for font files */
     float height;
     agg::rgba8 color;
+    bool sdf; /* render through the distance field atlas */
 } FontObject;
 
 #if defined(HAVE_FREETYPE2)
+static agg::font_sdf_atlas* sdf_atlas(FontObject* font);
 static FT_Face font_load(FontObject* font, bool outline=false);
+static font_source* font_source_get(PyObject* obj);
+static void font_source_release(font_source* source);
 #endif
 
 static void font_dealloc(FontObject* self);
@@ -279,9 +377,45 @@ static PyTypeObject FontType = {
 
 #define Font_Check(op) ((op) != NULL && Py_TYPE(op) == &FontType)
 
+typedef struct {
+    PyObject_HEAD
+    const agg::int8u* font; /* one of the embedded raster fonts */
+    agg::rgba8 color;
+} RasterFontObject;
+
+static void raster_font_dealloc(RasterFontObject* self);
+
+#ifdef IS_PY3K
+static PyTypeObject RasterFontType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "RasterFont", sizeof(RasterFontObject), 0,
+    /* methods */
+    (destructor) raster_font_dealloc, /* tp_dealloc */
+    0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+};
+
+#else
+static PyTypeObject RasterFontType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "RasterFont", sizeof(RasterFontObject), 0,
+    /* methods */
+    (destructor) raster_font_dealloc, /* tp_dealloc */
+    0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+};
+#endif
+
+#define RasterFont_Check(op) ((op) != NULL && Py_TYPE(op) == &RasterFontType)
+
 typedef struct {
     PyObject_HEAD
     agg::path_storage* path;
+    agg::path_storage_float* compact; /* replaces path after compact() */
+    agg::rect_d bbox; /* cached by path_bbox; invalid for an empty path */
+    int bbox_valid;
 } PathObject;
 
 static void path_dealloc(PathObject* self);
@@ -320,11 +454,196 @@ static PyTypeObject PathType = {
 
 #define Path_Check(op) ((op) != NULL && Py_TYPE(op) == &PathType)
 
+/* a sequence of paths drawn as one. the group holds references to the
+   paths, so changes to them show up the next time the group is drawn */
+typedef struct {
+    PyObject_HEAD
+    PathObject** paths;
+    int count;
+} PathGroupObject;
+
+static void path_group_dealloc(PathGroupObject* self);
+#ifdef IS_PY3K
+static PyObject* path_group_getattro(PathGroupObject* self, PyObject* nameobj);
+static PyTypeObject PathGroupType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "PathGroup", sizeof(PathGroupObject), 0,
+    /* methods */
+    (destructor) path_group_dealloc, /* tp_dealloc */
+    (printfunc)0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc)0, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc)0,  /*tp_hash*/
+    (ternaryfunc)0,  /*tp_call*/
+    (reprfunc)0,  /*tp_str*/
+    (getattrofunc)path_group_getattro, /* tp_getattro */
+};
+#else
+static PyObject* path_group_getattr(PathGroupObject* self, char* name);
+static PyTypeObject PathGroupType = {
+    PyObject_HEAD_INIT(NULL)
+    0, "PathGroup", sizeof(PathGroupObject), 0,
+    /* methods */
+    (destructor) path_group_dealloc, /* tp_dealloc */
+    0, /* tp_print */
+    (getattrfunc) path_group_getattr, /* tp_getattr */
+    0, /* tp_setattr */
+};
+#endif
+
+#define PathGroup_Check(op) ((op) != NULL && Py_TYPE(op) == &PathGroupType)
+
+/* a rasterized shape, kept in the serialized scanline format so that it
+   takes one block of memory and can be replayed at any offset */
+typedef struct {
+    PyObject_HEAD
+    agg::int8u* data;
+    unsigned size;
+} CoverageObject;
+
+static void coverage_dealloc(CoverageObject* self);
+#ifdef IS_PY3K
+static PyObject* coverage_getattro(CoverageObject* self, PyObject* nameobj);
+static PyTypeObject CoverageType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "Coverage", sizeof(CoverageObject), 0,
+    /* methods */
+    (destructor) coverage_dealloc, /* tp_dealloc */
+    (printfunc)0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc)0, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc)0,  /*tp_hash*/
+    (ternaryfunc)0,  /*tp_call*/
+    (reprfunc)0,  /*tp_str*/
+    (getattrofunc)coverage_getattro, /* tp_getattro */
+};
+#else
+static PyObject* coverage_getattr(CoverageObject* self, char* name);
+static PyTypeObject CoverageType = {
+    PyObject_HEAD_INIT(NULL)
+    0, "Coverage", sizeof(CoverageObject), 0,
+    /* methods */
+    (destructor) coverage_dealloc, /* tp_dealloc */
+    0, /* tp_print */
+    (getattrfunc) coverage_getattr, /* tp_getattr */
+    0, /* tp_setattr */
+};
+#endif
+
+#define Coverage_Check(op) ((op) != NULL && Py_TYPE(op) == &CoverageType)
+
+/* gets the inclusive device box of a coverage. returns false if it is
+   empty */
+static bool
+coverage_bbox(CoverageObject* self, agg::rect& box)
+{
+    if (!self->size)
+        return false;
+    agg::int16 v[4];
+    memcpy(v, self->data, sizeof(v));
+    box = agg::rect(v[0], v[1], v[2], v[3]);
+    return true;
+}
+
+/* vertex source that chains the paths in a group, in the same way as
+   agg::conv_concat does for two sources */
+class path_group_source
+{
+public:
+    path_group_source(PathGroupObject* group) : m_group(group), m_index(0) {}
+
+    void rewind(unsigned)
+    {
+        m_index = 0;
+        if (m_group->count)
+            rewind_part();
+    }
+
+    unsigned vertex(double* x, double* y)
+    {
+        while (m_index < m_group->count) {
+            PathObject* part = m_group->paths[m_index];
+            unsigned cmd = part->compact ? part->compact->vertex(x, y)
+                                         : part->path->vertex(x, y);
+            if (!agg::is_stop(cmd))
+                return cmd;
+            if (++m_index < m_group->count)
+                rewind_part();
+        }
+        return agg::path_cmd_stop;
+    }
+
+private:
+    void rewind_part()
+    {
+        PathObject* part = m_group->paths[m_index];
+        if (part->compact)
+            part->compact->rewind(0);
+        else
+            part->path->rewind(0);
+    }
+
+    PathGroupObject* m_group;
+    int m_index;
+};
+
+/* packed numeric array, exported through the buffer protocol (so that
+   memoryview(a) and numpy.asarray(a) work without copying) */
+typedef struct {
+    PyObject_HEAD
+    char* data;
+    const char* format;
+    int ndim;
+    Py_ssize_t itemsize;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+} ArrayObject;
+
+static void array_dealloc(ArrayObject* self);
+static int array_getbuffer(ArrayObject* self, Py_buffer* view, int flags);
+
+static PyBufferProcs array_as_buffer = {
+    (getbufferproc) array_getbuffer, /* bf_getbuffer */
+    0, /* bf_releasebuffer */
+};
+
+static PyTypeObject ArrayType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "Array", sizeof(ArrayObject), 0,
+    /* methods */
+    (destructor) array_dealloc, /* tp_dealloc */
+    0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+    0, /* tp_reserved */
+    0, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    0, /* tp_hash */
+    0, /* tp_call */
+    0, /* tp_str */
+    0, /* tp_getattro */
+    0, /* tp_setattro */
+    &array_as_buffer, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT, /* tp_flags */
+};
+
 static agg::rgba8 getcolor(PyObject* color, int opacity=255);
+static agg::path_storage* path_expand(PathObject* self);
 
 /* -------------------------------------------------------------------- */
 
-#if defined(HAVE_FREETYPE2)
 static int
 text_getchar(PyObject* string, int index, unsigned long* char_out)
 {
@@ -348,7 +667,31 @@ text_getchar(PyObject* string, int index, unsigned long* char_out)
     }
     return 0;
 }
-#endif
+
+/* copies a text string into a zero terminated buffer of glyph codes,
+   replacing characters that the raster font does not have. the caller
+   must delete the result. */
+static unsigned*
+raster_text_codes(PyObject* text, const agg::int8u* font)
+{
+    unsigned start = font[2];
+    unsigned end = start + font[3];
+    unsigned missing = ('?' >= start && '?' < end) ? '?' : start;
+
+    int count = 0;
+    unsigned long ch;
+    while (text_getchar(text, count, &ch))
+        count++;
+
+    unsigned* codes = new unsigned[count + 1];
+    int i;
+    for (i = 0; i < count; i++) {
+        text_getchar(text, i, &ch);
+        codes[i] = (ch >= start && ch < end) ? unsigned(ch) : missing;
+    }
+    codes[count] = 0;
+    return codes;
+}
 
 /* This template class is used to automagically instantiate drawing
    code for all pixel formats used by the library. */
@@ -359,30 +702,61 @@ public:
     const char* mode;
     virtual ~draw_adaptor_base() {};
     virtual void setantialias(bool flag) = 0;
+    virtual void setclip() = 0;
+    virtual void setmask() = 0;
     virtual void draw(agg::path_storage &path, PyObject* obj1,
                       PyObject* obj2=NULL) = 0;
+    virtual void draw(agg::path_storage_float &path, PyObject* obj1,
+                      PyObject* obj2=NULL) = 0;
+    virtual void draw(path_group_source &path, PyObject* obj1,
+                      PyObject* obj2=NULL) = 0;
+    virtual void rasterize(agg::path_storage &path,
+                           agg::scanline_storage_aa8 &shape) = 0;
+    virtual void rasterize(agg::path_storage_float &path,
+                           agg::scanline_storage_aa8 &shape) = 0;
+    virtual void rasterize(path_group_source &path,
+                           agg::scanline_storage_aa8 &shape) = 0;
+    virtual void fill(agg::scanline_storage_aa8 &shape, BrushObject* brush) = 0;
+    virtual void fill(agg::serialized_scanlines_adaptor_aa8 &shape,
+                      BrushObject* brush) = 0;
     virtual void drawtext(float xy[2], PyObject* text, FontObject* font) {};
+    virtual void drawtext_raster(float xy[2], PyObject* text,
+                                 RasterFontObject* font) = 0;
 };
 
 template<class PixFmt> class draw_adaptor : public draw_adaptor_base {
 
     DrawObject* self;
 
-    typedef agg::renderer_base<PixFmt> renderer_base;
-    typedef agg::renderer_scanline_aa_solid<renderer_base> renderer_aa;
-
+    /* the canvas buffer never moves, so the renderer is kept for the
+       lifetime of the object. it clips to every box in the clip region,
+       so one rasterization can fill several panels */
+    typedef agg::renderer_mclip<PixFmt> renderer_clip;
+
+    /* a second renderer multiplies coverage by the mask set with
+       setmask; it is only used while a mask is set */
+    typedef agg::pixfmt_amask_adaptor<PixFmt, agg::amask_no_clip_gray8>
+        pixfmt_masked;
+    typedef agg::renderer_mclip<pixfmt_masked> renderer_masked;
+
+    PixFmt pixf;
+    renderer_clip rb;
+    agg::amask_no_clip_gray8 amask;
+    pixfmt_masked pixf_masked;
+    renderer_masked rb_masked;
     agg::rasterizer_scanline_aa<> rasterizer;
     agg::scanline_p8 scanline;
 
 public:
-    draw_adaptor(DrawObject* self_, const char* mode_) 
+    draw_adaptor(DrawObject* self_, const char* mode_) :
+        pixf(*self_->buffer), rb(pixf),
+        pixf_masked(pixf, amask), rb_masked(pixf_masked)
     {
         self = self_;
         mode = mode_;
 
         setantialias(true);
-
-        rasterizer.clip_box(0,0, self->xsize, self->ysize);
+        setclip();
     }
 
     void setantialias(bool flag)
@@ -393,14 +767,54 @@ public:
             rasterizer.gamma(agg::gamma_threshold(0.5));
     };
 
+    void setclip()
+    {
+        const agg::rect& clip = self->clip;
+        setclip(rb);
+        setclip(rb_masked);
+        if (clip.is_valid())
+            rasterizer.clip_box(clip.x1, clip.y1, clip.x2 + 1, clip.y2 + 1);
+        else
+            rasterizer.clip_box(0, 0, 0, 0);
+    }
+
+    template<class Renderer>
+    void setclip(Renderer& ren)
+    {
+        if (self->clip.is_valid()) {
+            ren.reset_clipping(true);
+            for (unsigned i = 0; i < self->clips->size(); i++) {
+                const agg::rect& box = (*self->clips)[i];
+                ren.add_clip_box(box.x1, box.y1, box.x2, box.y2);
+            }
+        } else
+            ren.reset_clipping(false);
+    }
+
+    void setmask()
+    {
+        if (self->mask)
+            amask.attach(*self->mask);
+    }
+
     void draw(agg::path_storage &path, PyObject* obj1, PyObject* obj2=NULL)
     {
-        PixFmt pf(*self->buffer);
-        renderer_base rb(pf);
-        renderer_aa renderer(rb);
+        draw_path(path, obj1, obj2);
+    }
+
+    void draw(agg::path_storage_float &path, PyObject* obj1, PyObject* obj2=NULL)
+    {
+        draw_path(path, obj1, obj2);
+    }
 
-        agg::path_storage* p;
+    void draw(path_group_source &path, PyObject* obj1, PyObject* obj2=NULL)
+    {
+        draw_path(path, obj1, obj2);
+    }
 
+    template<class PathStorage>
+    void draw_path(PathStorage &path, PyObject* obj1, PyObject* obj2)
+    {
         PenObject* pen;
         if (Pen_Check(obj1))
             pen = (PenObject*) obj1;
@@ -417,24 +831,125 @@ public:
         else
             brush = NULL;
 
+        /* curves are kept in the path, and flattened here */
+        agg::conv_curve<PathStorage> curve(path);
+        curve.approximation_scale(draw_approximation_scale(self));
+
+        /* simplification works in device pixels, so it goes last. it is
+           left out when off, since even a zero tolerance drops
+           zero-length segments */
+        if (self->transform) {
+            typedef agg::conv_transform<agg::conv_curve<PathStorage>,
+                                        agg::trans_affine> transformed;
+            transformed tp(curve, *self->transform);
+            if (self->simplify > 0) {
+                agg::conv_simplify<transformed> simple(tp);
+                simple.tolerance(self->simplify);
+                render(simple, pen, brush);
+            } else
+                render(tp, pen, brush);
+        } else if (self->simplify > 0) {
+            agg::conv_simplify<agg::conv_curve<PathStorage> > simple(curve);
+            simple.tolerance(self->simplify);
+            render(simple, pen, brush);
+        } else
+            render(curve, pen, brush);
+    }
+
+    void rasterize(agg::path_storage &path, agg::scanline_storage_aa8 &shape)
+    {
+        rasterize_path(path, shape);
+    }
+
+    void rasterize(agg::path_storage_float &path,
+                   agg::scanline_storage_aa8 &shape)
+    {
+        rasterize_path(path, shape);
+    }
+
+    void rasterize(path_group_source &path, agg::scanline_storage_aa8 &shape)
+    {
+        rasterize_path(path, shape);
+    }
+
+    /* stores the coverage of a filled path, for combining with others
+       before it is rendered. the geometry is the same as in draw_path */
+    template<class PathStorage>
+    void rasterize_path(PathStorage &path, agg::scanline_storage_aa8 &shape)
+    {
+        agg::conv_curve<PathStorage> curve(path);
+        curve.approximation_scale(draw_approximation_scale(self));
+
         if (self->transform) {
-            p = new agg::path_storage();
-            agg::conv_transform<agg::path_storage, agg::trans_affine>
-                tp(path, *self->transform);
-            p->add_path(tp, 0, false);
+            typedef agg::conv_transform<agg::conv_curve<PathStorage>,
+                                        agg::trans_affine> transformed;
+            transformed tp(curve, *self->transform);
+            if (self->simplify > 0) {
+                agg::conv_simplify<transformed> simple(tp);
+                simple.tolerance(self->simplify);
+                add_fill(simple, 0.5);
+            } else
+                add_fill(tp, 0.5);
+        } else if (self->simplify > 0) {
+            agg::conv_simplify<agg::conv_curve<PathStorage> > simple(curve);
+            simple.tolerance(self->simplify);
+            add_fill(simple, 0.5);
         } else
-            p = &path;
+            add_fill(curve, 0.5);
+        agg::render_scanlines(rasterizer, scanline, shape);
+    }
+
+    void fill(agg::scanline_storage_aa8 &shape, BrushObject* brush)
+    {
+        fill_shape(shape, brush);
+    }
+
+    void fill(agg::serialized_scanlines_adaptor_aa8 &shape, BrushObject* brush)
+    {
+        fill_shape(shape, brush);
+    }
+
+    template<class Shape>
+    void fill_shape(Shape &shape, BrushObject* brush)
+    {
+        if (self->mask)
+            fill_shape(rb_masked, shape, brush);
+        else
+            fill_shape(rb, shape, brush);
+    }
 
+    template<class Renderer, class Shape>
+    void fill_shape(Renderer& ren, Shape &shape, BrushObject* brush)
+    {
+        agg::renderer_scanline_aa_solid<Renderer> renderer(ren);
+        renderer.color(brush->color);
+        agg::render_scanlines(shape, scanline, renderer);
+    }
+
+    template<class VertexSource>
+    void render(VertexSource& vs, PenObject* pen, BrushObject* brush)
+    {
+        if (self->mask)
+            render(rb_masked, vs, pen, brush);
+        else
+            render(rb, vs, pen, brush);
+    }
+
+    template<class Renderer, class VertexSource>
+    void render(Renderer& ren, VertexSource& vs, PenObject* pen,
+                BrushObject* brush)
+    {
+        agg::renderer_scanline_aa_solid<Renderer> renderer(ren);
+
+        /* geometry is clipped to the clip box in double precision before
+           it is contoured or stroked, with a margin wide enough that the
+           clipped edges never show. this keeps off-screen vertices out
+           of the stroker, and far-away coordinates out of the rasterizer's
+           fixed-point range */
+        const agg::rect& cb = self->clip;
         if (brush) {
             /* interior */
-            agg::conv_contour<agg::path_storage> contour(*p);
-            contour.auto_detect_orientation(true);
-            if (pen)
-                contour.width(pen->width / 2.0);
-            else
-                contour.width(0.5);
-            rasterizer.reset();
-            rasterizer.add_path(contour);
+            add_fill(vs, pen ? pen->width / 2.0 : 0.5);
             renderer.color(brush->color);
             agg::render_scanlines(rasterizer, scanline, renderer);
         }
@@ -442,26 +957,98 @@ public:
         if (pen) {
             /* outline */
             /* FIXME: add path for dashed lines */
-            agg::conv_stroke<agg::path_storage> stroke(*p);
+            /* miter joins reach up to twice the pen width (the default
+               miter limit is 4) */
+            double margin = 2 * pen->width + 1;
+            agg::conv_clip_polyline<VertexSource> clip(vs);
+            clip.clip_box(cb.x1 - margin, cb.y1 - margin,
+                          cb.x2 + 1 + margin, cb.y2 + 1 + margin);
+            agg::conv_stroke<agg::conv_clip_polyline<VertexSource> >
+                stroke(clip);
             stroke.width(pen->width);
+            /* the stroke is generated in device space */
+            stroke.approximation_scale(1.0 / self->tolerance);
             rasterizer.reset();
             rasterizer.add_path(stroke);
             renderer.color(pen->color);
             agg::render_scanlines(rasterizer, scanline, renderer);
         }
+    }
+
+    /* loads the interior of a path into the rasterizer, grown by the
+       given width */
+    template<class VertexSource>
+    void add_fill(VertexSource& vs, double width)
+    {
+        const agg::rect& cb = self->clip;
+        agg::conv_close_polygon<VertexSource> closed(vs);
+        agg::conv_clip_polygon<agg::conv_close_polygon<VertexSource> >
+            clip(closed);
+        clip.clip_box(cb.x1 - width - 1, cb.y1 - width - 1,
+                      cb.x2 + width + 2, cb.y2 + width + 2);
+        agg::conv_contour<agg::conv_clip_polygon<
+            agg::conv_close_polygon<VertexSource> > > contour(clip);
+        contour.auto_detect_orientation(true);
+        contour.width(width);
+        rasterizer.reset();
+        rasterizer.add_path(contour);
+    }
+
+    void drawtext_raster(float xy[2], PyObject* text, RasterFontObject* font)
+    {
+        if (self->mask)
+            drawtext_raster(rb_masked, xy, text, font);
+        else
+            drawtext_raster(rb, xy, text, font);
+    }
+
+    template<class Renderer>
+    void drawtext_raster(Renderer& ren, float xy[2], PyObject* text,
+                         RasterFontObject* font)
+    {
+        typedef typename PixFmt::color_type color_type;
+        typedef agg::glyph_raster_bin<color_type> glyph_gen;
+        typedef agg::renderer_raster_htext_solid<Renderer, glyph_gen>
+            renderer_text;
+
+        glyph_gen glyph(font->font);
+        renderer_text renderer(ren, glyph);
+        renderer.color(color_type(font->color));
+
+        /* raster glyphs cannot be transformed; only the position is */
+        double x = xy[0];
+        double y = xy[1];
         if (self->transform)
-            delete p;
+            self->transform->transform(&x, &y);
+        x = floor(x + 0.5);
+        y = floor(y + 0.5) + glyph.height() - glyph.base_line();
+
+        unsigned* codes = raster_text_codes(text, font->font);
+        renderer.render_text(x, y, codes, true);
+        delete [] codes;
     }
 
 #if defined(HAVE_FREETYPE2)
     void drawtext(float xy[2], PyObject* text, FontObject* font)
     {
-        PixFmt pf(*self->buffer);
-        renderer_base rb(pf);
-        renderer_aa renderer(rb);
+        if (self->mask)
+            drawtext(rb_masked, xy, text, font);
+        else
+            drawtext(rb, xy, text, font);
+    }
+
+    template<class Renderer>
+    void drawtext(Renderer& ren, float xy[2], PyObject* text, FontObject* font)
+    {
+        agg::renderer_scanline_aa_solid<Renderer> renderer(ren);
 
-        typedef agg::conv_curve<font_manager_type::path_adaptor_type> curve_t;
-        curve_t curves(font_manager.path_adaptor());
+        typedef font_manager_type::path_adaptor_type glyph_path_t;
+        glyph_path_t& glyph_path = font_manager.path_adaptor();
+
+        if (font->sdf) {
+            drawtext_sdf(ren, xy, text, font);
+            return;
+        }
 
         bool outline = (self->transform != NULL);
 
@@ -469,32 +1056,58 @@ public:
         if (!face)
             return;
 
+        /* glyphs are flattened once per scale and cached, so the scale is
+           rounded to a power of two to keep the number of variants small */
+        if (outline) {
+            int exp;
+            frexp(4.0 * draw_approximation_scale(self), &exp);
+            font_engine.approximation_scale(ldexp(1.0, exp));
+        }
+
         double x = xy[0];
         double y = xy[1] + face->size->metrics.ascender/64.0;
 
         renderer.color(font->color);
-        curves.approximation_scale(1);
+
+        /* outline glyphs are cached pre-flattened, and the whole string
+           is accumulated into a single rasterizer pass */
+        if (outline)
+            rasterizer.reset();
 
         unsigned long ch;
         int index = 0;
 
         while (text_getchar(text, index, &ch)) {
             const agg::glyph_cache* glyph;
-            glyph = font_manager.glyph(ch);
-            if (!glyph)
-                continue;
-            font_manager.add_kerning(&x, &y);
-            font_manager.init_embedded_adaptors(glyph, x, y);
             if (outline) {
-                rasterizer.reset();
-                if (self->transform) {
-                    agg::conv_transform<curve_t, agg::trans_affine>
-                        tp(curves, *self->transform);
-                    rasterizer.add_path(tp);
-                } else
-                    rasterizer.add_path(curves);
-                agg::render_scanlines(rasterizer, scanline, renderer);
+                glyph = font_manager.glyph(ch);
+                if (glyph) {
+                    font_manager.add_kerning(&x, &y);
+                    font_manager.init_embedded_adaptors(glyph, x, y);
+                }
             } else {
+                /* use the cached bitmap closest to the pen position */
+                double gx = x;
+                glyph = font_manager.glyph(ch, font_manager.subpixel_phase(&gx));
+                if (glyph && font_manager.add_kerning(&x, &y)) {
+                    gx = x;
+                    glyph = font_manager.glyph(
+                        ch, font_manager.subpixel_phase(&gx)
+                        );
+                }
+                if (glyph)
+                    font_manager.init_embedded_adaptors(glyph, gx, y);
+            }
+            if (!glyph) {
+                index++;
+                continue;
+            }
+            if (glyph->data_type == agg::glyph_data_outline) {
+                agg::conv_transform<glyph_path_t, agg::trans_affine>
+                    tp(glyph_path, *self->transform);
+                rasterizer.add_path(tp);
+            } else {
+                /* bitmap glyph (or a non-scalable font) */
                 agg::render_scanlines(
                     font_manager.gray8_adaptor(),
                     font_manager.gray8_scanline(), renderer
@@ -504,24 +1117,111 @@ public:
             y += glyph->advance_y;
             index++;
         }
+
+        if (outline)
+            agg::render_scanlines(rasterizer, scanline, renderer);
     }
-#endif
-};
 
-/* -------------------------------------------------------------------- */
+    template<class Renderer>
+    void drawtext_sdf(Renderer& ren, float xy[2], PyObject* text,
+                      FontObject* font)
+    {
+        typedef typename PixFmt::color_type color_type;
+        typedef agg::span_interpolator_linear<> interpolator_type;
+        typedef agg::span_sdf<color_type, interpolator_type> span_gen_type;
+        typedef agg::renderer_scanline_aa<Renderer, span_gen_type>
+            renderer_sdf;
+
+        agg::font_sdf_atlas* atlas = sdf_atlas(font);
+        if (!atlas)
+            return;
 
-static void clear(DrawObject* self, PyObject* background)
-{
-    if (background && background != Py_None) {
-        agg::rgba8 ink = getcolor(background);
-        unsigned char* p = self->buffer_data;
-        int c, i;
-        switch (self->mode) {
-            case agg::pix_format_gray8:
-                c = (ink.r*299 + ink.g*587 + ink.b*114) / 1000;
-                memset(self->buffer_data, c, self->buffer_size);
-                break;
-            case agg::pix_format_rgb24:
+
+        agg::trans_affine inverse;
+        interpolator_type interpolator(inverse);
+        agg::span_allocator<color_type> allocator;
+        span_gen_type span_gen(allocator, atlas->image(), interpolator);
+        span_gen.color(color_type(font->color));
+        renderer_sdf renderer(ren, span_gen);
+
+        double scale = font->height / atlas->base_size();
+        double x = xy[0];
+        double y = xy[1] + atlas->ascender() * scale;
+
+        /* a copy, since the atlas may be cleared by the next glyph */
+        agg::glyph_sdf prev_glyph;
+        const agg::glyph_sdf* prev = NULL;
+        unsigned long ch;
+        int index = 0;
+
+        while (text_getchar(text, index++, &ch)) {
+            const agg::glyph_sdf* glyph = atlas->glyph(ch);
+            if (!glyph)
+                continue;
+            double dx = 0, dy = 0;
+            if (atlas->add_kerning(prev, glyph, &dx, &dy)) {
+                x += dx * scale;
+                y += dy * scale;
+            }
+            prev_glyph = *glyph;
+            prev = &prev_glyph;
+            if (glyph->width > 0 && glyph->height > 0) {
+                /* map the atlas entry onto the glyph box on the canvas */
+                agg::trans_affine mtx = agg::trans_affine_translation(
+                    -glyph->x, -glyph->y
+                    );
+                mtx *= agg::trans_affine_scaling(scale);
+                mtx *= agg::trans_affine_translation(
+                    x + glyph->left * scale, y - glyph->top * scale
+                    );
+                if (self->transform)
+                    mtx *= *self->transform;
+                inverse = mtx;
+                inverse.invert();
+
+                /* half a device pixel of anti-aliasing, in field units */
+                double pixels = mtx.scale();
+                span_gen.smoothing(
+                    0.5 * atlas->value_scale() / (pixels > 0 ? pixels : 1)
+                    );
+                span_gen.clip(
+                    glyph->x, glyph->y,
+                    glyph->x + glyph->width - 1, glyph->y + glyph->height - 1
+                    );
+
+                agg::path_storage box;
+                box.move_to(glyph->x, glyph->y);
+                box.line_to(glyph->x + glyph->width, glyph->y);
+                box.line_to(glyph->x + glyph->width, glyph->y + glyph->height);
+                box.line_to(glyph->x, glyph->y + glyph->height);
+                box.close_polygon();
+                agg::conv_transform<agg::path_storage, agg::trans_affine>
+                    tp(box, mtx);
+                rasterizer.reset();
+                rasterizer.add_path(tp);
+                agg::render_scanlines(rasterizer, scanline, renderer);
+            }
+            x += glyph->advance_x * scale;
+            y += glyph->advance_y * scale;
+        }
+    }
+#endif
+};
+
+/* -------------------------------------------------------------------- */
+
+static void clear(DrawObject* self, PyObject* background)
+{
+    if (background && background != Py_None) {
+        agg::rgba8 ink = getcolor(background);
+        unsigned char* p = self->buffer_data;
+        int c, i;
+        switch (self->mode) {
+            case agg::pix_format_gray8:
+                c = (ink.r*299 + ink.g*587 + ink.b*114) / 1000;
+                memset(self->buffer_data, c, self->buffer_size);
+                break;
+            case agg::pix_format_rgb24:
                 for (i = 0; i < self->buffer_size; i += 3) {
                     p[i+0] = ink.r;
                     p[i+1] = ink.g;
@@ -703,6 +1403,16 @@ draw_new(PyObject* self_, PyObject* args)
     self->ysize = ysize;
 
     self->transform = NULL;
+    self->tolerance = 1.0;
+    self->simplify = 0.0;
+    self->clips = new agg::pod_deque<agg::rect, 2>();
+    self->clips->add(agg::rect(0, 0, xsize - 1, ysize - 1));
+    self->clip = (*self->clips)[0];
+    self->scratch = NULL;
+    self->mask = NULL;
+    self->mask_data = NULL;
+    self->points = NULL;
+    self->points_size = 0;
 
     self->image = image;
     if (image) {
@@ -752,15 +1462,60 @@ struct PointF {
      (float) PyFloat_AsDouble(op))
 #endif
 
+/* true if GETFLOAT can convert the object without running Python code */
+#ifdef IS_PY3K
+#define PLAINFLOAT(op) (PyLong_Check(op) || PyFloat_Check(op))
+#else
+#define PLAINFLOAT(op) (PyInt_Check(op) || PyFloat_Check(op))
+#endif
+
+/* returns a tuple holding the coordinates of a sequence as plain numbers.
+   coordinates that cannot be converted become -1, as with GETFLOAT */
+static PyObject*
+getpoints_plain(PyObject* xyIn)
+{
+    PyObject* items = PySequence_Tuple(xyIn);
+    if (!items)
+        return NULL;
+
+    Py_ssize_t i, n = PyTuple_GET_SIZE(items);
+    PyObject* plain = PyTuple_New(n);
+    if (!plain) {
+        Py_DECREF(items);
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        PyObject* op = PyTuple_GET_ITEM(items, i);
+        if (PLAINFLOAT(op))
+            Py_INCREF(op);
+        else {
+            op = PyNumber_Float(op);
+            if (!op) {
+                PyErr_Clear();
+                op = PyFloat_FromDouble(-1.0);
+            }
+            if (!op) {
+                Py_DECREF(items);
+                Py_DECREF(plain);
+                return NULL;
+            }
+        }
+        PyTuple_SET_ITEM(plain, i, op);
+    }
+    Py_DECREF(items);
+
+    return plain;
+}
+
+/* converts a coordinate sequence to an array of points. if a drawing
+   object is given, the points are stored in its buffer, which is reused
+   by the next call; otherwise, the caller must delete the array */
 static PointF*
-getpoints(PyObject* xyIn, int* count)
+getpoints(PyObject* xyIn, int* count, DrawObject* draw=NULL)
 {
     PointF *xy;
     int i, n;
 
-    /* FIXME: use local buffer (provided by caller) for short
-       sequences */
-
     if (!PySequence_Check(xyIn)) {
         PyErr_SetString(PyExc_TypeError, "argument must be a sequence");
         return NULL;
@@ -776,10 +1531,44 @@ getpoints(PyObject* xyIn, int* count)
         return NULL;
         }
 
+    /* converting anything but plain numbers can run Python code, which
+       may draw on the same object (and reallocate its buffer) or change
+       the sequence. such sequences are converted up front, so that no
+       Python code runs while the points are stored */
+    PyObject* plain = NULL;
+    bool simple = PyList_Check(xyIn) || PyTuple_Check(xyIn);
+    for (i = 0; simple && i < n; i++)
+        simple = PLAINFLOAT(PySequence_Fast_GET_ITEM(xyIn, i));
+    if (!simple) {
+        plain = getpoints_plain(xyIn);
+        if (!plain)
+            return NULL;
+        xyIn = plain;
+        n = (int) PyTuple_GET_SIZE(plain);
+        if (n & 1) {
+            Py_DECREF(plain);
+            PyErr_SetString(PyExc_TypeError,
+                            "expected even number of coordinates");
+            return NULL;
+        }
+    }
+
     n /= 2;
 
-    xy = new PointF[n+1];
+    if (draw) {
+        if (draw->points_size < n+1) {
+            int size = draw->points_size ? draw->points_size : 64;
+            while (size < n+1)
+                size *= 2;
+            delete [] draw->points;
+            draw->points = new PointF[size];
+            draw->points_size = size;
+        }
+        xy = draw->points;
+    } else
+        xy = new PointF[n+1];
     if (!xy) {
+        Py_XDECREF(plain);
         PyErr_NoMemory();
         *count = -1;
         return NULL;
@@ -790,21 +1579,12 @@ getpoints(PyObject* xyIn, int* count)
             xy[i].X = GETFLOAT(PyList_GET_ITEM(xyIn, i+i));
             xy[i].Y = GETFLOAT(PyList_GET_ITEM(xyIn, i+i+1));
         }
-    else if (PyTuple_Check(xyIn))
+    else
         for (i = 0; i < n; i++) {
             xy[i].X = GETFLOAT(PyTuple_GET_ITEM(xyIn, i+i));
             xy[i].Y = GETFLOAT(PyTuple_GET_ITEM(xyIn, i+i+1));
         }
-    else
-        for (i = 0; i < n; i++) {
-            PyObject *op;
-            op = PySequence_GetItem(xyIn, i+i);
-            xy[i].X = GETFLOAT(op);
-            Py_DECREF(op);
-            op = PySequence_GetItem(xyIn, i+i+1);
-            xy[i].Y = GETFLOAT(op);
-            Py_DECREF(op);
-        }
+    Py_XDECREF(plain);
 
     PyErr_Clear();
 
@@ -813,6 +1593,428 @@ getpoints(PyObject* xyIn, int* count)
     return xy;
 }
 
+/* color strings.  named colors are looked up in a perfect hash table
+   (the CSS3 / X11 names known by PIL's ImageColor).  the displacement
+   and slot tables below were generated offline for this name list:
+   bucket = hash & 63, slot = ((hash >> 8) + d[bucket] * ((hash >> 20) | 1))
+   & 255, where hash is the 32-bit FNV-1a hash of the lowercase name. */
+
+typedef struct {
+    const char* name;
+    agg::int8u r, g, b;
+} named_color;
+
+static const named_color named_colors[] = {
+    {"aliceblue", 0xF0, 0xF8, 0xFF},
+    {"antiquewhite", 0xFA, 0xEB, 0xD7},
+    {"aqua", 0x00, 0xFF, 0xFF},
+    {"aquamarine", 0x7F, 0xFF, 0xD4},
+    {"azure", 0xF0, 0xFF, 0xFF},
+    {"beige", 0xF5, 0xF5, 0xDC},
+    {"bisque", 0xFF, 0xE4, 0xC4},
+    {"black", 0x00, 0x00, 0x00},
+    {"blanchedalmond", 0xFF, 0xEB, 0xCD},
+    {"blue", 0x00, 0x00, 0xFF},
+    {"blueviolet", 0x8A, 0x2B, 0xE2},
+    {"brown", 0xA5, 0x2A, 0x2A},
+    {"burlywood", 0xDE, 0xB8, 0x87},
+    {"cadetblue", 0x5F, 0x9E, 0xA0},
+    {"chartreuse", 0x7F, 0xFF, 0x00},
+    {"chocolate", 0xD2, 0x69, 0x1E},
+    {"coral", 0xFF, 0x7F, 0x50},
+    {"cornflowerblue", 0x64, 0x95, 0xED},
+    {"cornsilk", 0xFF, 0xF8, 0xDC},
+    {"crimson", 0xDC, 0x14, 0x3C},
+    {"cyan", 0x00, 0xFF, 0xFF},
+    {"darkblue", 0x00, 0x00, 0x8B},
+    {"darkcyan", 0x00, 0x8B, 0x8B},
+    {"darkgoldenrod", 0xB8, 0x86, 0x0B},
+    {"darkgray", 0xA9, 0xA9, 0xA9},
+    {"darkgreen", 0x00, 0x64, 0x00},
+    {"darkgrey", 0xA9, 0xA9, 0xA9},
+    {"darkkhaki", 0xBD, 0xB7, 0x6B},
+    {"darkmagenta", 0x8B, 0x00, 0x8B},
+    {"darkolivegreen", 0x55, 0x6B, 0x2F},
+    {"darkorange", 0xFF, 0x8C, 0x00},
+    {"darkorchid", 0x99, 0x32, 0xCC},
+    {"darkred", 0x8B, 0x00, 0x00},
+    {"darksalmon", 0xE9, 0x96, 0x7A},
+    {"darkseagreen", 0x8F, 0xBC, 0x8F},
+    {"darkslateblue", 0x48, 0x3D, 0x8B},
+    {"darkslategray", 0x2F, 0x4F, 0x4F},
+    {"darkslategrey", 0x2F, 0x4F, 0x4F},
+    {"darkturquoise", 0x00, 0xCE, 0xD1},
+    {"darkviolet", 0x94, 0x00, 0xD3},
+    {"deeppink", 0xFF, 0x14, 0x93},
+    {"deepskyblue", 0x00, 0xBF, 0xFF},
+    {"dimgray", 0x69, 0x69, 0x69},
+    {"dimgrey", 0x69, 0x69, 0x69},
+    {"dodgerblue", 0x1E, 0x90, 0xFF},
+    {"firebrick", 0xB2, 0x22, 0x22},
+    {"floralwhite", 0xFF, 0xFA, 0xF0},
+    {"forestgreen", 0x22, 0x8B, 0x22},
+    {"fuchsia", 0xFF, 0x00, 0xFF},
+    {"gainsboro", 0xDC, 0xDC, 0xDC},
+    {"ghostwhite", 0xF8, 0xF8, 0xFF},
+    {"gold", 0xFF, 0xD7, 0x00},
+    {"goldenrod", 0xDA, 0xA5, 0x20},
+    {"gray", 0x80, 0x80, 0x80},
+    {"green", 0x00, 0x80, 0x00},
+    {"greenyellow", 0xAD, 0xFF, 0x2F},
+    {"grey", 0x80, 0x80, 0x80},
+    {"honeydew", 0xF0, 0xFF, 0xF0},
+    {"hotpink", 0xFF, 0x69, 0xB4},
+    {"indianred", 0xCD, 0x5C, 0x5C},
+    {"indigo", 0x4B, 0x00, 0x82},
+    {"ivory", 0xFF, 0xFF, 0xF0},
+    {"khaki", 0xF0, 0xE6, 0x8C},
+    {"lavender", 0xE6, 0xE6, 0xFA},
+    {"lavenderblush", 0xFF, 0xF0, 0xF5},
+    {"lawngreen", 0x7C, 0xFC, 0x00},
+    {"lemonchiffon", 0xFF, 0xFA, 0xCD},
+    {"lightblue", 0xAD, 0xD8, 0xE6},
+    {"lightcoral", 0xF0, 0x80, 0x80},
+    {"lightcyan", 0xE0, 0xFF, 0xFF},
+    {"lightgoldenrodyellow", 0xFA, 0xFA, 0xD2},
+    {"lightgray", 0xD3, 0xD3, 0xD3},
+    {"lightgreen", 0x90, 0xEE, 0x90},
+    {"lightgrey", 0xD3, 0xD3, 0xD3},
+    {"lightpink", 0xFF, 0xB6, 0xC1},
+    {"lightsalmon", 0xFF, 0xA0, 0x7A},
+    {"lightseagreen", 0x20, 0xB2, 0xAA},
+    {"lightskyblue", 0x87, 0xCE, 0xFA},
+    {"lightslategray", 0x77, 0x88, 0x99},
+    {"lightslategrey", 0x77, 0x88, 0x99},
+    {"lightsteelblue", 0xB0, 0xC4, 0xDE},
+    {"lightyellow", 0xFF, 0xFF, 0xE0},
+    {"lime", 0x00, 0xFF, 0x00},
+    {"limegreen", 0x32, 0xCD, 0x32},
+    {"linen", 0xFA, 0xF0, 0xE6},
+    {"magenta", 0xFF, 0x00, 0xFF},
+    {"maroon", 0x80, 0x00, 0x00},
+    {"mediumaquamarine", 0x66, 0xCD, 0xAA},
+    {"mediumblue", 0x00, 0x00, 0xCD},
+    {"mediumorchid", 0xBA, 0x55, 0xD3},
+    {"mediumpurple", 0x93, 0x70, 0xDB},
+    {"mediumseagreen", 0x3C, 0xB3, 0x71},
+    {"mediumslateblue", 0x7B, 0x68, 0xEE},
+    {"mediumspringgreen", 0x00, 0xFA, 0x9A},
+    {"mediumturquoise", 0x48, 0xD1, 0xCC},
+    {"mediumvioletred", 0xC7, 0x15, 0x85},
+    {"midnightblue", 0x19, 0x19, 0x70},
+    {"mintcream", 0xF5, 0xFF, 0xFA},
+    {"mistyrose", 0xFF, 0xE4, 0xE1},
+    {"moccasin", 0xFF, 0xE4, 0xB5},
+    {"navajowhite", 0xFF, 0xDE, 0xAD},
+    {"navy", 0x00, 0x00, 0x80},
+    {"oldlace", 0xFD, 0xF5, 0xE6},
+    {"olive", 0x80, 0x80, 0x00},
+    {"olivedrab", 0x6B, 0x8E, 0x23},
+    {"orange", 0xFF, 0xA5, 0x00},
+    {"orangered", 0xFF, 0x45, 0x00},
+    {"orchid", 0xDA, 0x70, 0xD6},
+    {"palegoldenrod", 0xEE, 0xE8, 0xAA},
+    {"palegreen", 0x98, 0xFB, 0x98},
+    {"paleturquoise", 0xAF, 0xEE, 0xEE},
+    {"palevioletred", 0xDB, 0x70, 0x93},
+    {"papayawhip", 0xFF, 0xEF, 0xD5},
+    {"peachpuff", 0xFF, 0xDA, 0xB9},
+    {"peru", 0xCD, 0x85, 0x3F},
+    {"pink", 0xFF, 0xC0, 0xCB},
+    {"plum", 0xDD, 0xA0, 0xDD},
+    {"powderblue", 0xB0, 0xE0, 0xE6},
+    {"purple", 0x80, 0x00, 0x80},
+    {"rebeccapurple", 0x66, 0x33, 0x99},
+    {"red", 0xFF, 0x00, 0x00},
+    {"rosybrown", 0xBC, 0x8F, 0x8F},
+    {"royalblue", 0x41, 0x69, 0xE1},
+    {"saddlebrown", 0x8B, 0x45, 0x13},
+    {"salmon", 0xFA, 0x80, 0x72},
+    {"sandybrown", 0xF4, 0xA4, 0x60},
+    {"seagreen", 0x2E, 0x8B, 0x57},
+    {"seashell", 0xFF, 0xF5, 0xEE},
+    {"sienna", 0xA0, 0x52, 0x2D},
+    {"silver", 0xC0, 0xC0, 0xC0},
+    {"skyblue", 0x87, 0xCE, 0xEB},
+    {"slateblue", 0x6A, 0x5A, 0xCD},
+    {"slategray", 0x70, 0x80, 0x90},
+    {"slategrey", 0x70, 0x80, 0x90},
+    {"snow", 0xFF, 0xFA, 0xFA},
+    {"springgreen", 0x00, 0xFF, 0x7F},
+    {"steelblue", 0x46, 0x82, 0xB4},
+    {"tan", 0xD2, 0xB4, 0x8C},
+    {"teal", 0x00, 0x80, 0x80},
+    {"thistle", 0xD8, 0xBF, 0xD8},
+    {"tomato", 0xFF, 0x63, 0x47},
+    {"turquoise", 0x40, 0xE0, 0xD0},
+    {"violet", 0xEE, 0x82, 0xEE},
+    {"wheat", 0xF5, 0xDE, 0xB3},
+    {"white", 0xFF, 0xFF, 0xFF},
+    {"whitesmoke", 0xF5, 0xF5, 0xF5},
+    {"yellow", 0xFF, 0xFF, 0x00},
+    {"yellowgreen", 0x9A, 0xCD, 0x32},
+};
+static const unsigned char named_color_displacement[64] = {
+      0,   0,   0,   1,   1,   0,   4,   0,   0,   0,   0,   0,   0,   5,   1,   0,
+      0,   5,   1,   1,   3,   0,   0,   0,   2,   1,   0,   0,   3,   4,   1,   4,
+      0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   0,   0,   7,   1,   3,   0,
+      1,   5,   6,   2,   0,   0,   0,   5,   0,   0,   0,   0,   1,   4,   4,   1,
+};
+static const unsigned char named_color_slots[256] = {
+    131, 255,  55,  92, 255, 255,  61, 144,  93,  88, 255, 255, 255,  40,  77,   5,
+    255, 255, 255,  71,  84,  78,  47,  75, 255,  56, 255, 100, 255,  26,  42, 255,
+    255, 255, 255, 255, 128,  72, 255, 255, 115,  31,  35, 255, 255, 255, 255,  90,
+    255, 255,  25, 255,  48, 255, 255,  11,  13,  62,  33,  52, 101, 255, 255,  46,
+    140, 255, 255, 255, 255, 255, 127, 125,  17,  80, 255,   7, 255, 255, 255,   2,
+    255,  60,  73,  20, 255, 255,  22, 255,  70, 255,  10, 255, 255, 111, 255, 255,
+    255,  95, 126, 255, 146, 255,  23, 255,  85,  57, 255, 255,  63, 255, 255, 255,
+     16,  83, 255, 105, 135, 255, 255, 255, 255, 147, 138,  91, 255,  39,  21, 255,
+    141, 117, 255, 124, 123,  45,  87, 255,  12, 255, 136, 255, 255, 255, 255, 255,
+    255, 104,  49, 255, 133,   3,  68, 130, 106,  28,  66,   6, 255, 255,  51,  76,
+     58, 142,   8,  64,  18, 255, 255, 255, 255, 118,  38,  65, 255, 120,  41,  44,
+    116, 255, 255,  53, 143, 255,  79,  24,  43, 108, 107, 139,  27, 102,  67,  97,
+    119, 255,   4, 255, 255,   0, 145, 132, 255, 255,  82,  19,  86, 134,  69, 114,
+    255, 122, 137, 103, 255,  98,  32,  50, 255,  15, 112,  37,  99,   1,  74, 255,
+      9, 255, 113,  30,  14,  89,  29,  59, 255, 255,  34, 255, 255, 109, 255, 110,
+    255, 255,  36,  81,  96, 121, 255, 255, 255, 129, 255, 255,  94,  54, 255, 255,
+};
+
+static unsigned
+color_hash(const char* name)
+{
+    unsigned hash = 2166136261U;
+    for (; *name; name++) {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static const named_color*
+color_lookup(const char* name, unsigned hash)
+{
+    unsigned step = (hash >> 20) | 1;
+    unsigned slot = ((hash >> 8) +
+                     named_color_displacement[hash & 63] * step) & 255;
+    unsigned index = named_color_slots[slot];
+    if (index == 255 || strcmp(named_colors[index].name, name))
+        return NULL;
+    return &named_colors[index];
+}
+
+/* parses a comma separated argument list up to the closing parenthesis,
+   without going through the C locale */
+static int
+color_args(const char* p, double* values, int* percent, int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        while (*p == ' ') p++;
+        if (*p < '0' || *p > '9')
+            return 0;
+        double v = 0;
+        for (; *p >= '0' && *p <= '9'; p++)
+            v = v * 10 + (*p - '0');
+        if (*p == '.') {
+            double scale = 0.1;
+            for (p++; *p >= '0' && *p <= '9'; p++, scale /= 10)
+                v += (*p - '0') * scale;
+        }
+        while (*p == ' ') p++;
+        percent[i] = (*p == '%');
+        if (percent[i]) p++;
+        while (*p == ' ') p++;
+        values[i] = v;
+        if (*p++ != (i == count-1 ? ')' : ','))
+            return 0;
+    }
+    return *p == '\0';
+}
+
+static int
+color_byte(double v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : int(v);
+}
+
+/* resolves a lowercase color string.  alpha is set to -1 unless the
+   string gives one */
+static int
+parsecolor(const char* ink, unsigned hash, int rgba[4])
+{
+    rgba[3] = -1;
+
+    const named_color* named = color_lookup(ink, hash);
+    if (named) {
+        rgba[0] = named->r; rgba[1] = named->g; rgba[2] = named->b;
+        return 1;
+    }
+
+    int i, n = strlen(ink);
+    if (ink[0] == '#') {
+        if (n != 4 && n != 5 && n != 7 && n != 9)
+            return 0;
+        int digits[8];
+        for (i = 1; i < n; i++) {
+            char c = ink[i];
+            if (c >= '0' && c <= '9')
+                digits[i-1] = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                digits[i-1] = c - 'a' + 10;
+            else
+                return 0;
+        }
+        if (n <= 5) /* #rgb, #rgba */
+            for (i = 0; i < n-1; i++)
+                rgba[i] = digits[i] * 17;
+        else /* #rrggbb, #rrggbbaa */
+            for (i = 0; i < (n-1)/2; i++)
+                rgba[i] = digits[2*i] * 16 + digits[2*i+1];
+        return 1;
+    }
+
+    double v[4];
+    int pct[4];
+    if (!strncmp(ink, "rgb(", 4) && color_args(ink+4, v, pct, 3)) {
+        if (pct[0] != pct[1] || pct[0] != pct[2])
+            return 0;
+        for (i = 0; i < 3; i++)
+            rgba[i] = color_byte(pct[i] ? v[i] * 255 / 100.0 + 0.5 : v[i]);
+        return 1;
+    }
+    if (!strncmp(ink, "rgba(", 5) && color_args(ink+5, v, pct, 4)) {
+        if (pct[0] || pct[1] || pct[2] || pct[3])
+            return 0;
+        for (i = 0; i < 4; i++)
+            rgba[i] = color_byte(v[i]);
+        return 1;
+    }
+
+    int hsl = !strncmp(ink, "hsl(", 4);
+    if ((hsl || !strncmp(ink, "hsv(", 4) || !strncmp(ink, "hsb(", 4)) &&
+        color_args(ink+4, v, pct, 3)) {
+        if (pct[0] || !pct[1] || !pct[2])
+            return 0;
+        double h = fmod(v[0] / 360.0, 1.0) * 6;
+        double sat = v[1] / 100.0, val = v[2] / 100.0;
+        double c; /* chroma */
+        if (hsl)
+            c = (1 - fabs(2 * val - 1)) * sat;
+        else
+            c = val * sat;
+        double x = c * (1 - fabs(fmod(h, 2.0) - 1));
+        double m = hsl ? val - c / 2 : val - c;
+        double rgb[3];
+        switch (int(h)) {
+        case 0: rgb[0] = c; rgb[1] = x; rgb[2] = 0; break;
+        case 1: rgb[0] = x; rgb[1] = c; rgb[2] = 0; break;
+        case 2: rgb[0] = 0; rgb[1] = c; rgb[2] = x; break;
+        case 3: rgb[0] = 0; rgb[1] = x; rgb[2] = c; break;
+        case 4: rgb[0] = x; rgb[1] = 0; rgb[2] = c; break;
+        default: rgb[0] = c; rgb[1] = 0; rgb[2] = x; break;
+        }
+        for (i = 0; i < 3; i++)
+            rgba[i] = color_byte((rgb[i] + m) * 255 + 0.5);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* bounded cache of resolved color strings, indexed by hash */
+#define COLOR_CACHE_SIZE 256
+#define COLOR_CACHE_KEY 32
+
+static struct {
+    char key[COLOR_CACHE_KEY];
+    int rgba[4];
+} color_cache[COLOR_CACHE_SIZE];
+
+/* first-use initialization (the PIL import, the FreeType library) runs
+   under this lock. the import can release the GIL, and free-threaded
+   builds have none, so another thread could otherwise see it half done.
+   waiting threads let go of the GIL, so the importing thread can run */
+#ifdef Py_GIL_DISABLED
+static PyMutex first_use_mutex;
+
+static void
+first_use_lock(void)
+{
+    PyMutex_Lock(&first_use_mutex);
+}
+
+static void
+first_use_unlock(void)
+{
+    PyMutex_Unlock(&first_use_mutex);
+}
+#else
+static PyThread_type_lock first_use_mutex;
+
+static void
+first_use_lock(void)
+{
+    /* allocated under the GIL, so only one thread gets here first */
+    if (!first_use_mutex)
+        first_use_mutex = PyThread_allocate_lock();
+    if (!PyThread_acquire_lock(first_use_mutex, NOWAIT_LOCK)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(first_use_mutex, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+static void
+first_use_unlock(void)
+{
+    PyThread_release_lock(first_use_mutex);
+}
+#endif
+
+/* returns PIL's ImageColor.getrgb, importing it on first use. this keeps
+   PIL out of the import of aggdraw itself. returns NULL if the helper
+   could not be set up */
+static PyObject*
+getcolor_fallback(void)
+{
+    static int initialized = 0;
+    first_use_lock();
+    if (!initialized) {
+        PyObject* g = PyDict_New();
+        PyDict_SetItemString(g, "__builtins__", PyEval_GetBuiltins());
+        PyObject* result = PyRun_String(
+            "try:\n"
+            "    from PIL import ImageColor\n"
+            "except ImportError:\n"
+            "    ImageColor = None\n"
+
+            "def getcolor(v):\n"
+            "    return ImageColor.getrgb(v)\n"
+
+            "", Py_file_input, g, NULL
+
+            );
+        Py_XDECREF(result);
+        PyErr_Clear();
+
+        /* published only once the helper exists */
+        aggdraw_getcolor_obj = PyDict_GetItemString(g, "getcolor");
+        initialized = 1;
+    }
+    PyObject* getcolor = aggdraw_getcolor_obj;
+    first_use_unlock();
+    return getcolor;
+}
+
+#ifdef Py_GIL_DISABLED
+static PyMutex color_cache_mutex;
+#define COLOR_CACHE_LOCK() PyMutex_Lock(&color_cache_mutex)
+#define COLOR_CACHE_UNLOCK() PyMutex_Unlock(&color_cache_mutex)
+#else
+#define COLOR_CACHE_LOCK()
+#define COLOR_CACHE_UNLOCK()
+#endif
+
 static agg::rgba8
 getcolor(PyObject* color, int opacity) 
 {
@@ -827,84 +2029,208 @@ getcolor(PyObject* color, int opacity)
         return agg::rgba8(ink, ink, ink, opacity);
     }
 #endif
-    char buffer[10];
-    char* ink = NULL;
+    const char* text = NULL;
+    PyObject* ascii_color = NULL;
     if (PyUnicode_Check(color)) {
-        PyObject* ascii_color = PyUnicode_AsASCIIString(color);
-        if (ascii_color == NULL) {
-            ink = NULL;
-        } else {
-            strncpy(buffer, PyBytes_AsString(ascii_color), sizeof buffer);
-            buffer[sizeof(buffer)-1] = '\0'; /* to be on the safe side */
-            ink = buffer;
-            Py_XDECREF(ascii_color);
-        }
+        ascii_color = PyUnicode_AsASCIIString(color);
+        if (ascii_color)
+            text = PyBytes_AsString(ascii_color);
+        else
+            PyErr_Clear();
     } else if (PyBytes_Check(color)) {
-        ink = PyBytes_AsString(color);
+        text = PyBytes_AsString(color);
     }
-    /* hex colors */
-    if (ink && ink[0] == '#' && strlen(ink) == 7) {
-        int i = strtol(ink+1, NULL, 16); /* FIXME: rough parsing */
-        return agg::rgba8((i>>16)&255,(i>>8)&255,i&255,opacity);
+
+    if (text) {
+        /* color strings are case insensitive */
+        char ink[101];
+        int i;
+        for (i = 0; text[i] && i < (int) sizeof(ink) - 1; i++)
+            ink[i] = (text[i] >= 'A' && text[i] <= 'Z') ?
+                text[i] - 'A' + 'a' : text[i];
+        int too_long = (text[i] != '\0');
+        ink[i] = '\0';
+        Py_XDECREF(ascii_color);
+
+        int rgba[4] = { 0, 0, 0, -1 };
+        if (!too_long) {
+            unsigned hash = color_hash(ink);
+            int cached = (i < COLOR_CACHE_KEY);
+            int slot = hash % COLOR_CACHE_SIZE;
+
+            COLOR_CACHE_LOCK();
+            if (cached && !strcmp(color_cache[slot].key, ink) && ink[0]) {
+                memcpy(rgba, color_cache[slot].rgba, sizeof(rgba));
+                COLOR_CACHE_UNLOCK();
+                return agg::rgba8(rgba[0], rgba[1], rgba[2],
+                                  rgba[3] < 0 ? opacity : rgba[3]);
+            }
+            COLOR_CACHE_UNLOCK();
+
+            PyObject* fallback = NULL;
+            if (!parsecolor(ink, hash, rgba)) {
+                fallback = getcolor_fallback();
+                /* without the helper the color is not known, so the
+                   black default is not cached */
+                if (!fallback)
+                    cached = 0;
+            }
+            if (fallback) {
+                /* unknown color: pass it to the Python layer */
+                PyObject* result;
+                result = PyObject_CallFunction(fallback, "O", color);
+                if (result) {
+                    if (!PyArg_ParseTuple(result, "iii|i", &rgba[0], &rgba[1],
+                                          &rgba[2], &rgba[3]))
+                        rgba[0] = rgba[1] = rgba[2] = 0, rgba[3] = -1;
+                    Py_DECREF(result);
+                }
+                PyErr_Clear();
+            }
+
+            if (cached) {
+                COLOR_CACHE_LOCK();
+                strcpy(color_cache[slot].key, ink);
+                memcpy(color_cache[slot].rgba, rgba, sizeof(rgba));
+                COLOR_CACHE_UNLOCK();
+            }
+        }
+        /* unknown colors default to black (FIXME: raise an exception instead?) */
+        return agg::rgba8(rgba[0], rgba[1], rgba[2],
+                          rgba[3] < 0 ? opacity : rgba[3]);
     }
 
     int red, green, blue, alpha = opacity;
     if (PyArg_ParseTuple(color, "iii|i", &red, &green, &blue, &alpha))
         return agg::rgba8(red, green, blue, alpha);
     PyErr_Clear();
-    /* unknown color: pass it to the Python layer */
-    if (aggdraw_getcolor_obj) {
-        PyObject* result;
-        result = PyObject_CallFunction(aggdraw_getcolor_obj, "O", color);
-        if (result) {
-            int ok = PyArg_ParseTuple(result, "iii", &red, &green, &blue);
-            Py_DECREF(result);
-            if (ok)
-                return agg::rgba8(red, green, blue, opacity);
+
+    /* default to black (FIXME: raise an exception instead?) */
+    return agg::rgba8(0, 0, 0, opacity);
+}
+
+/* -------------------------------------------------------------------- */
+
+/* returns the bounding box of a path, including any curve control points.
+   the box is cached until the path is modified */
+static const agg::rect_d&
+path_bbox(PathObject* self)
+{
+    if (!self->bbox_valid) {
+        self->bbox = agg::rect_d(1, 1, 0, 0);
+        if (self->compact)
+            agg::bounding_rect_single(*self->compact, 0,
+                                      &self->bbox.x1, &self->bbox.y1,
+                                      &self->bbox.x2, &self->bbox.y2);
+        else
+            agg::bounding_rect_single(*self->path, 0,
+                                      &self->bbox.x1, &self->bbox.y1,
+                                      &self->bbox.x2, &self->bbox.y2);
+        self->bbox_valid = 1;
+    }
+    return self->bbox;
+}
+
+/* checks if a user space box can touch the clip box once it is
+   transformed and outlined with the given pen (if any) */
+static bool
+draw_visible(DrawObject* self, const agg::rect_d& box, PyObject* obj1,
+             PyObject* obj2)
+{
+    const agg::rect& clip = self->clip;
+    if (!clip.is_valid())
+        return false;
+
+    double x1 = box.x1, y1 = box.y1, x2 = box.x2, y2 = box.y2;
+    if (x1 > x2) { x1 = box.x2; x2 = box.x1; }
+    if (y1 > y2) { y1 = box.y2; y2 = box.y1; }
+    if (self->transform) {
+        double x[4] = { box.x1, box.x2, box.x2, box.x1 };
+        double y[4] = { box.y1, box.y1, box.y2, box.y2 };
+        for (int i = 0; i < 4; i++) {
+            self->transform->transform(&x[i], &y[i]);
+            if (i == 0 || x[i] < x1) x1 = x[i];
+            if (i == 0 || y[i] < y1) y1 = y[i];
+            if (i == 0 || x[i] > x2) x2 = x[i];
+            if (i == 0 || y[i] > y2) y2 = y[i];
         }
-        PyErr_Clear();
     }
-    /* check for well-known color names (HTML) */
-    if (PyUnicode_Check(color) || PyBytes_Check(color)) {
-        if (!strcmp(ink, "aqua"))
-            return agg::rgba8(0x00,0xFF,0xFF,opacity);
-        if (!strcmp(ink, "black"))
-            return agg::rgba8(0x00,0x00,0x00,opacity);
-        if (!strcmp(ink, "blue"))
-            return agg::rgba8(0x00,0x00,0xFF,opacity);
-        if (!strcmp(ink, "fuchsia"))
-            return agg::rgba8(0xFF,0x00,0xFF,opacity);
-        if (!strcmp(ink, "gray"))
-            return agg::rgba8(0x80,0x80,0x80,opacity);
-        if (!strcmp(ink, "green"))
-            return agg::rgba8(0x00,0x80,0x00,opacity);
-        if (!strcmp(ink, "lime"))
-            return agg::rgba8(0x00,0xFF,0x00,opacity);
-        if (!strcmp(ink, "maroon"))
-            return agg::rgba8(0x80,0x00,0x00,opacity);
-        if (!strcmp(ink, "navy"))
-            return agg::rgba8(0x00,0x00,0x80,opacity);
-        if (!strcmp(ink, "olive"))
-            return agg::rgba8(0x80,0x80,0x00,opacity);
-        if (!strcmp(ink, "purple"))
-            return agg::rgba8(0x80,0x00,0x80,opacity);
-        if (!strcmp(ink, "red"))
-            return agg::rgba8(0xFF,0x00,0x00,opacity);
-        if (!strcmp(ink, "silver"))
-            return agg::rgba8(0xC0,0xC0,0xC0,opacity);
-        if (!strcmp(ink, "teal"))
-            return agg::rgba8(0x00,0x80,0x80,opacity);
-        if (!strcmp(ink, "white"))
-            return agg::rgba8(0xFF,0xFF,0xFF,opacity);
-        if (!strcmp(ink, "yellow"))
-            return agg::rgba8(0xFF,0xFF,0x00,opacity);
-        /* extra colors (used by test2d.py) */
-        if (!strcmp(ink, "gold"))
-            return agg::rgba8(0xFF,0xD7,0x00,opacity);
 
+    /* same margins as the clipping stage in draw_adaptor::render */
+    double margin = 2;
+    if (Pen_Check(obj1))
+        margin = 2 * ((PenObject*) obj1)->width + 1;
+    else if (Pen_Check(obj2))
+        margin = 2 * ((PenObject*) obj2)->width + 1;
+
+    return x2 >= clip.x1 - margin && y2 >= clip.y1 - margin &&
+           x1 <= clip.x2 + 1 + margin && y1 <= clip.y2 + 1 + margin;
+}
+
+/* same as draw_visible, for the bounds of a point array */
+static bool
+draw_visible(DrawObject* self, const PointF* xy, int count, PyObject* obj1,
+             PyObject* obj2)
+{
+    if (count < 1)
+        return false;
+    agg::rect_d box(xy[0].X, xy[0].Y, xy[0].X, xy[0].Y);
+    for (int i = 1; i < count; i++) {
+        if (xy[i].X < box.x1) box.x1 = xy[i].X;
+        if (xy[i].Y < box.y1) box.y1 = xy[i].Y;
+        if (xy[i].X > box.x2) box.x2 = xy[i].X;
+        if (xy[i].Y > box.y2) box.y2 = xy[i].Y;
+    }
+    return draw_visible(self, box, obj1, obj2);
+}
+
+static void
+path_draw(DrawObject* self, PathObject* path, PyObject* obj1,
+          PyObject* obj2=NULL)
+{
+    /* skip paths that are empty or entirely off the canvas */
+    const agg::rect_d& bbox = path_bbox(path);
+    if (!bbox.is_valid() || !draw_visible(self, bbox, obj1, obj2))
+        return;
+
+    if (path->compact)
+        self->draw->draw(*path->compact, obj1, obj2);
+    else
+        self->draw->draw(*path->path, obj1, obj2);
+}
+
+/* returns the union of the bounding boxes of the paths in a group. this
+   is not cached, since the paths may change behind the group's back */
+static agg::rect_d
+path_group_bbox(PathGroupObject* self)
+{
+    agg::rect_d bbox(1, 1, 0, 0);
+    for (int i = 0; i < self->count; i++) {
+        const agg::rect_d& box = path_bbox(self->paths[i]);
+        if (!box.is_valid())
+            continue;
+        if (!bbox.is_valid())
+            bbox = box;
+        else {
+            if (box.x1 < bbox.x1) bbox.x1 = box.x1;
+            if (box.y1 < bbox.y1) bbox.y1 = box.y1;
+            if (box.x2 > bbox.x2) bbox.x2 = box.x2;
+            if (box.y2 > bbox.y2) bbox.y2 = box.y2;
+        }
     }
-    /* default to black (FIXME: raise an exception instead?) */
-    return agg::rgba8(0, 0, 0, opacity);
+    return bbox;
+}
+
+static void
+path_group_draw(DrawObject* self, PathGroupObject* group, PyObject* obj1,
+                PyObject* obj2=NULL)
+{
+    agg::rect_d bbox = path_group_bbox(group);
+    if (!bbox.is_valid() || !draw_visible(self, bbox, obj1, obj2))
+        return;
+
+    path_group_source source(group);
+    self->draw->draw(source, obj1, obj2);
 }
 
 /* -------------------------------------------------------------------- */
@@ -933,13 +2259,18 @@ draw_arc(DrawObject* self, PyObject* args)
                           &x0, &y0, &x1, &y1, &start, &end, &pen))
         return NULL;
 
-    agg::path_storage path;
+    if (!draw_visible(self, agg::rect_d(x0, y0, x1, y1), pen, NULL)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    agg::path_storage& path = draw_scratch(self);
     agg::arc arc(
         (x1+x0)/2, (y1+y0)/2, (x1-x0)/2, (y1-y0)/2,
         -start * (float) (M_PI / 180.0), -end * (float) (M_PI / 180.0),
         false
         );
-    arc.approximation_scale(1);
+    arc.approximation_scale(draw_approximation_scale(self));
     path.add_path(arc);
 
     self->draw->draw(path, pen);
@@ -979,13 +2310,18 @@ draw_chord(DrawObject* self, PyObject* args)
                           &x0, &y0, &x1, &y1, &start, &end, &pen, &brush))
         return NULL;
 
-    agg::path_storage path;
+    if (!draw_visible(self, agg::rect_d(x0, y0, x1, y1), pen, brush)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    agg::path_storage& path = draw_scratch(self);
     agg::arc arc(
         (x1+x0)/2, (y1+y0)/2, (x1-x0)/2, (y1-y0)/2,
         -start * (float) (M_PI / 180.0), -end * (float) (M_PI / 180.0),
         false
         );
-    arc.approximation_scale(1);
+    arc.approximation_scale(draw_approximation_scale(self));
     path.add_path(arc);
     path.close_polygon();
 
@@ -1022,9 +2358,14 @@ draw_ellipse(DrawObject* self, PyObject* args)
                           &x0, &y0, &x1, &y1, &brush, &pen))
         return NULL;
 
-    agg::path_storage path;
+    if (!draw_visible(self, agg::rect_d(x0, y0, x1, y1), pen, brush)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    agg::path_storage& path = draw_scratch(self);
     agg::ellipse ellipse((x1+x0)/2, (y1+y0)/2, (x1-x0)/2, (y1-y0)/2, 8);
-    ellipse.approximation_scale(1);
+    ellipse.approximation_scale(draw_approximation_scale(self));
     path.add_path(ellipse);
 
     self->draw->draw(path, pen, brush);
@@ -1064,17 +2405,22 @@ draw_line(DrawObject* self, PyObject* args)
         return NULL;
 
     if (Path_Check(xyIn)) {
-        self->draw->draw(*((PathObject*) xyIn)->path, pen);
+        path_draw(self, (PathObject*) xyIn, pen);
+    } else if (PathGroup_Check(xyIn)) {
+        path_group_draw(self, (PathGroupObject*) xyIn, pen);
     } else {
         int count;
-        PointF *xy = getpoints(xyIn, &count);
+        PointF *xy = getpoints(xyIn, &count, self);
         if (!xy)
             return NULL;
-        agg::path_storage path;
+        if (!draw_visible(self, xy, count, pen, NULL)) {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+        agg::path_storage& path = draw_scratch(self);
         path.move_to(xy[0].X, xy[0].Y);
         for (int i = 1; i < count; i++)
             path.line_to(xy[i].X, xy[i].Y);
-        delete [] xy;
         self->draw->draw(path, pen);
     }
 
@@ -1114,16 +2460,21 @@ draw_pieslice(DrawObject* self, PyObject* args)
                           &x0, &y0, &x1, &y1, &start, &end, &pen, &brush))
         return NULL;
 
+    if (!draw_visible(self, agg::rect_d(x0, y0, x1, y1), pen, brush)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
     float x = (x1+x0)/2;
     float y = (y1+y0)/2;
 
-    agg::path_storage path;
+    agg::path_storage& path = draw_scratch(self);
     agg::arc arc(
         x, y, (x1-x0)/2, (y1-y0)/2,
         -start * (float) (M_PI / 180.0), -end * (float) (M_PI / 180.0),
         false
         );
-    arc.approximation_scale(1);
+    arc.approximation_scale(draw_approximation_scale(self));
     path.add_path(arc);
     path.line_to(x, y);
     path.close_polygon();
@@ -1159,18 +2510,23 @@ draw_polygon(DrawObject* self, PyObject* args)
         return NULL;
 
     if (Path_Check(xyIn)) {
-        self->draw->draw(*((PathObject*) xyIn)->path, pen, brush);
+        path_draw(self, (PathObject*) xyIn, pen, brush);
+    } else if (PathGroup_Check(xyIn)) {
+        path_group_draw(self, (PathGroupObject*) xyIn, pen, brush);
     } else {
         int count;
-        PointF *xy = getpoints(xyIn, &count);
+        PointF *xy = getpoints(xyIn, &count, self);
         if (!xy)
             return NULL;
-        agg::path_storage path;
+        if (!draw_visible(self, xy, count, pen, brush)) {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+        agg::path_storage& path = draw_scratch(self);
         path.move_to(xy[0].X, xy[0].Y);
         for (int i = 1; i < count; i++)
             path.line_to(xy[i].X, xy[i].Y);
         path.close_polygon();
-        delete [] xy;
         self->draw->draw(path, pen, brush);
     }
 
@@ -1178,24 +2534,413 @@ draw_polygon(DrawObject* self, PyObject* args)
     return Py_None;
 }
 
-const char *draw_rectangle_doc = "Draw a rectangle.\n"
-                                 "\n"
-                                 "If a brush is given, it is used to fill the rectangle.\n"
-                                 "If a pen is given, it is used to draw an outline around the rectangle.\n"
-                                 "Either one (or both) can be left out.\n"
-                                 "\n"
-                                 "Parameters\n"
-                                 "----------\n"
-                                 "xy : iterable\n"
-                                 "    A 4-element Python sequence (x, y, x, y), with the\n"
-                                 "    upper left corner given first.\n"
-                                 "pen : Pen\n"
-                                 "    Optional pen object created by the `Pen` factory.\n"
-                                 "brush : Brush\n"
-                                 "    Optional brush object created by the `Brush` factory.\n";
-
-static PyObject*
-draw_rectangle(DrawObject* self, PyObject* args)
+const char *draw_combine_doc = "Fill the union, intersection, etc. of several shapes.\n"
+                               "\n"
+                               "The shapes are rasterized and combined as coverage, not as\n"
+                               "vector geometry, and the result is filled in one pass. Areas\n"
+                               "where translucent shapes overlap are therefore blended once.\n"
+                               "\n"
+                               "Parameters\n"
+                               "----------\n"
+                               "op : str\n"
+                               "    One of \"union\", \"intersection\", \"xor\" or \"difference\".\n"
+                               "    The difference is the first shape minus all the others.\n"
+                               "shapes : iterable\n"
+                               "    A Python sequence of Path objects, PathGroup objects, or\n"
+                               "    polygon coordinate sequences (x, y, x, y, ...).\n"
+                               "brush : Brush\n"
+                               "    Brush object created by the `Brush` factory.\n";
+
+/* combines two shapes into a third */
+static void
+shape_combine(agg::sbool_op_e op, agg::scanline_storage_aa8& shape1,
+              agg::scanline_storage_aa8& shape2,
+              agg::scanline_storage_aa8& out)
+{
+    agg::scanline_p8 sl1, sl2, sl;
+    agg::sbool_combine_shapes_aa(op, shape1, shape2, sl1, sl2, sl, out);
+}
+
+/* combines a list of shapes pairwise, so that each stored span takes
+   part in log2(count) passes rather than count passes. the shapes are
+   freed, and the result is left in the first slot */
+static void
+shape_reduce(agg::sbool_op_e op, agg::scanline_storage_aa8** shapes,
+             int count)
+{
+    while (count > 1) {
+        int n = 0;
+        for (int i = 0; i < count; i += 2) {
+            if (i + 1 < count) {
+                agg::scanline_storage_aa8* out = new agg::scanline_storage_aa8;
+                shape_combine(op, *shapes[i], *shapes[i+1], *out);
+                delete shapes[i];
+                delete shapes[i+1];
+                shapes[n++] = out;
+            } else
+                shapes[n++] = shapes[i];
+        }
+        count = n;
+    }
+}
+
+/* unites a list of shapes through a coverage buffer over their bounds,
+   using the cover formula of sbool_unite_spans_aa. unlike pairwise
+   merging, each stored span is visited once. the shapes are freed, and
+   the result is left in the first slot */
+static void
+shape_unite(agg::scanline_storage_aa8** shapes, int count)
+{
+    int x1 = 0x7FFFFFFF, y1 = 0x7FFFFFFF, x2 = -0x7FFFFFFF, y2 = -0x7FFFFFFF;
+    int i;
+    for (i = 0; i < count; i++) {
+        agg::scanline_storage_aa8& shape = *shapes[i];
+        if (shape.min_x() > shape.max_x() || shape.min_y() > shape.max_y())
+            continue;
+        if (shape.min_x() < x1) x1 = shape.min_x();
+        if (shape.min_y() < y1) y1 = shape.min_y();
+        if (shape.max_x() > x2) x2 = shape.max_x();
+        if (shape.max_y() > y2) y2 = shape.max_y();
+    }
+
+    agg::scanline_storage_aa8* out = new agg::scanline_storage_aa8;
+    if (x1 <= x2 && y1 <= y2) {
+        int width = x2 - x1 + 1, height = y2 - y1 + 1;
+        agg::int8u* buffer = new agg::int8u[(size_t) width * height];
+        memset(buffer, 0, (size_t) width * height);
+
+        for (i = 0; i < count; i++) {
+            agg::scanline_storage_aa8& shape = *shapes[i];
+            agg::scanline_storage_aa8::embedded_scanline sl(shape);
+            if (!shape.rewind_scanlines())
+                continue;
+            while (shape.sweep_scanline(sl)) {
+                agg::int8u* row = buffer + (size_t) (sl.y() - y1) * width - x1;
+                agg::scanline_storage_aa8::embedded_scanline::const_iterator
+                    span = sl.begin();
+                for (unsigned n = sl.num_spans(); n; n--, ++span) {
+                    int len = span->len < 0 ? -span->len : span->len;
+                    const agg::int8u* covers = span->covers;
+                    agg::int8u* p = row + span->x;
+                    for (int j = 0; j < len; j++, p++) {
+                        unsigned c = span->len < 0 ? *covers : covers[j];
+                        unsigned cover = 255 * 255 - (255 - *p) * (255 - c);
+                        *p = cover == 255 * 255 ? 255 : cover >> 8;
+                    }
+                }
+            }
+            delete shapes[i];
+        }
+
+        /* solid runs are stored as solid spans, as the rasterizer does */
+        agg::scanline_p8 sl;
+        sl.reset(x1, x2);
+        out->prepare(width + 2);
+        for (int y = 0; y < height; y++) {
+            const agg::int8u* row = buffer + (size_t) y * width;
+            sl.reset_spans();
+            for (int x = 0; x < width; ) {
+                if (!row[x]) {
+                    x++;
+                    continue;
+                }
+                int end = x + 1;
+                if (row[x] == 255) {
+                    while (end < width && row[end] == 255)
+                        end++;
+                    sl.add_span(x1 + x, end - x, 255);
+                } else {
+                    while (end < width && row[end] && row[end] != 255)
+                        end++;
+                    sl.add_cells(x1 + x, end - x, row + x);
+                }
+                x = end;
+            }
+            if (sl.num_spans()) {
+                sl.finalize(y1 + y);
+                out->render(sl);
+            }
+        }
+        delete [] buffer;
+    } else {
+        for (i = 0; i < count; i++)
+            delete shapes[i];
+    }
+    shapes[0] = out;
+}
+
+/* rasterizes and combines a sequence of shapes. returns a new shape,
+   or NULL with an exception set */
+static agg::scanline_storage_aa8*
+draw_combine_shapes(DrawObject* self, const char* opname, PyObject* shapesIn)
+{
+    agg::sbool_op_e op;
+    if (!strcmp(opname, "union"))
+        op = agg::sbool_or;
+    else if (!strcmp(opname, "intersection"))
+        op = agg::sbool_and;
+    else if (!strcmp(opname, "xor"))
+        op = agg::sbool_xor;
+    else if (!strcmp(opname, "difference"))
+        op = agg::sbool_a_minus_b;
+    else {
+        PyErr_SetString(PyExc_ValueError, "unknown operation");
+        return NULL;
+    }
+
+    /* converting coordinates may run Python code, so the shapes are
+       taken from a snapshot of the sequence */
+    if (!PySequence_Check(shapesIn)) {
+        PyErr_SetString(PyExc_TypeError, "expected a sequence of shapes");
+        return NULL;
+    }
+    PyObject* seq = PySequence_Tuple(shapesIn);
+    if (!seq)
+        return NULL;
+
+    int i, count = (int) PyTuple_GET_SIZE(seq);
+    agg::scanline_storage_aa8** shapes = new agg::scanline_storage_aa8*[count];
+    for (i = 0; i < count; i++) {
+        PyObject* item = PyTuple_GET_ITEM(seq, i);
+        agg::scanline_storage_aa8* shape = new agg::scanline_storage_aa8;
+        shapes[i] = shape;
+        if (Path_Check(item)) {
+            PathObject* path = (PathObject*) item;
+            if (path->compact)
+                self->draw->rasterize(*path->compact, *shape);
+            else
+                self->draw->rasterize(*path->path, *shape);
+        } else if (PathGroup_Check(item)) {
+            path_group_source source((PathGroupObject*) item);
+            self->draw->rasterize(source, *shape);
+        } else {
+            int n;
+            PointF *xy = getpoints(item, &n, self);
+            if (!xy)
+                break;
+            /* no points, so the shape stays empty */
+            if (n == 0)
+                continue;
+            agg::path_storage& path = draw_scratch(self);
+            path.move_to(xy[0].X, xy[0].Y);
+            for (int j = 1; j < n; j++)
+                path.line_to(xy[j].X, xy[j].Y);
+            path.close_polygon();
+            self->draw->rasterize(path, *shape);
+        }
+    }
+    Py_DECREF(seq);
+
+    if (i < count) {
+        for (int j = 0; j <= i; j++)
+            delete shapes[j];
+        delete [] shapes;
+        return NULL;
+    }
+
+    agg::scanline_storage_aa8* shape;
+    if (count > 0) {
+        if (op == agg::sbool_a_minus_b && count > 2) {
+            /* subtract the union of the others */
+            shape_unite(shapes + 1, count - 1);
+            count = 2;
+        }
+        if (op == agg::sbool_or && count > 2)
+            shape_unite(shapes, count);
+        else
+            shape_reduce(op, shapes, count);
+        shape = shapes[0];
+    } else
+        shape = new agg::scanline_storage_aa8;
+    delete [] shapes;
+
+    return shape;
+}
+
+static PyObject*
+draw_combine(DrawObject* self, PyObject* args)
+{
+    char* opname;
+    PyObject* shapesIn;
+    PyObject* brush;
+    if (!PyArg_ParseTuple(args, "sOO:combine", &opname, &shapesIn, &brush))
+        return NULL;
+
+    if (!Brush_Check(brush)) {
+        PyErr_SetString(PyExc_TypeError, "expected a Brush");
+        return NULL;
+    }
+
+    agg::scanline_storage_aa8* shape = draw_combine_shapes(self, opname,
+                                                           shapesIn);
+    if (!shape)
+        return NULL;
+    self->draw->fill(*shape, (BrushObject*) brush);
+    delete shape;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_coverage_doc = "Rasterize shapes once, for filling them many times.\n"
+                                "\n"
+                                "The shapes are combined as for `combine`, using the current\n"
+                                "transform, clip region and antialiasing setting.\n"
+                                "\n"
+                                "Parameters\n"
+                                "----------\n"
+                                "shapes : iterable\n"
+                                "    A Python sequence of Path objects, PathGroup objects, or\n"
+                                "    polygon coordinate sequences (x, y, x, y, ...).\n"
+                                "op : str, optional\n"
+                                "    How to combine the shapes. Default \"union\".\n"
+                                "\n"
+                                "Returns\n"
+                                "-------\n"
+                                "Coverage\n"
+                                "    A coverage object, for use with `fill`.\n"
+                                "\n"
+                                "Raises\n"
+                                "------\n"
+                                "ValueError\n"
+                                "    If the canvas or the shape is too large to store.\n";
+
+/* checks that a shape can be serialized and replayed: coordinates and
+   span counts are stored as int16, and scanline sizes as int16u */
+static bool
+coverage_fits(agg::scanline_storage_aa8& shape)
+{
+    if (shape.min_x() < -32768 || shape.max_x() > 32767 ||
+        shape.min_y() < -32768 || shape.max_y() > 32767)
+        return false;
+
+    agg::scanline_storage_aa8::embedded_scanline sl(shape);
+    if (!shape.rewind_scanlines())
+        return true;
+    while (shape.sweep_scanline(sl)) {
+        if (sl.num_spans() > 32767)
+            return false;
+        unsigned size = 3 * sizeof(agg::int16);
+        agg::scanline_storage_aa8::embedded_scanline::const_iterator
+            span = sl.begin();
+        for (unsigned n = sl.num_spans(); n; n--, ++span)
+            size += 2 * sizeof(agg::int16) +
+                    (span->len < 0 ? 1 : span->len);
+        if (size > 0xFFFF)
+            return false;
+    }
+    return true;
+}
+
+static PyObject*
+draw_coverage(DrawObject* self, PyObject* args)
+{
+    PyObject* shapesIn;
+    const char* opname = "union";
+    if (!PyArg_ParseTuple(args, "O|s:coverage", &shapesIn, &opname))
+        return NULL;
+
+    if (self->xsize > 32767 || self->ysize > 32767) {
+        PyErr_SetString(PyExc_ValueError, "canvas too large for coverage");
+        return NULL;
+    }
+
+    agg::scanline_storage_aa8* shape = draw_combine_shapes(self, opname,
+                                                           shapesIn);
+    if (!shape)
+        return NULL;
+    if (!coverage_fits(*shape)) {
+        delete shape;
+        PyErr_SetString(PyExc_ValueError, "shape too large for coverage");
+        return NULL;
+    }
+
+    CoverageObject* coverage = PyObject_NEW(CoverageObject, &CoverageType);
+    if (coverage == NULL) {
+        delete shape;
+        return NULL;
+    }
+    coverage->data = NULL;
+    coverage->size = 0;
+    if (shape->rewind_scanlines()) {
+        coverage->size = shape->byte_size();
+        coverage->data = new agg::int8u[coverage->size];
+        shape->serialize(coverage->data);
+    }
+    delete shape;
+
+    return (PyObject*) coverage;
+}
+
+const char *draw_fill_doc = "Fill a coverage object created by `coverage`.\n"
+                            "\n"
+                            "No geometry is processed; the stored scanlines are blended\n"
+                            "directly, through the current clip region and mask.\n"
+                            "\n"
+                            "Parameters\n"
+                            "----------\n"
+                            "coverage : Coverage\n"
+                            "    The shape to fill.\n"
+                            "brush : Brush\n"
+                            "    Brush object created by the `Brush` factory.\n"
+                            "offset : tuple, optional\n"
+                            "    A (dx, dy) offset in device pixels, rounded to whole pixels.\n";
+
+static PyObject*
+draw_fill(DrawObject* self, PyObject* args)
+{
+    PyObject* coverageIn;
+    PyObject* brush;
+    double dx = 0, dy = 0;
+    if (!PyArg_ParseTuple(args, "OO|(dd):fill", &coverageIn, &brush, &dx, &dy))
+        return NULL;
+
+    if (!Coverage_Check(coverageIn)) {
+        PyErr_SetString(PyExc_TypeError, "expected a Coverage");
+        return NULL;
+    }
+    if (!Brush_Check(brush)) {
+        PyErr_SetString(PyExc_TypeError, "expected a Brush");
+        return NULL;
+    }
+
+    CoverageObject* coverage = (CoverageObject*) coverageIn;
+    agg::rect box;
+    if (coverage_bbox(coverage, box)) {
+        const agg::rect& clip = self->clip;
+        int ox = int(floor(dx + 0.5));
+        int oy = int(floor(dy + 0.5));
+        if (clip.is_valid() &&
+            box.x1 + ox <= clip.x2 && box.x2 + ox >= clip.x1 &&
+            box.y1 + oy <= clip.y2 && box.y2 + oy >= clip.y1) {
+            agg::serialized_scanlines_adaptor_aa8 shape(
+                coverage->data, coverage->size, dx, dy);
+            self->draw->fill(shape, (BrushObject*) brush);
+        }
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_rectangle_doc = "Draw a rectangle.\n"
+                                 "\n"
+                                 "If a brush is given, it is used to fill the rectangle.\n"
+                                 "If a pen is given, it is used to draw an outline around the rectangle.\n"
+                                 "Either one (or both) can be left out.\n"
+                                 "\n"
+                                 "Parameters\n"
+                                 "----------\n"
+                                 "xy : iterable\n"
+                                 "    A 4-element Python sequence (x, y, x, y), with the\n"
+                                 "    upper left corner given first.\n"
+                                 "pen : Pen\n"
+                                 "    Optional pen object created by the `Pen` factory.\n"
+                                 "brush : Brush\n"
+                                 "    Optional brush object created by the `Brush` factory.\n";
+
+static PyObject*
+draw_rectangle(DrawObject* self, PyObject* args)
 {
     float x0, y0, x1, y1;
     PyObject* brush = NULL;
@@ -1204,7 +2949,12 @@ draw_rectangle(DrawObject* self, PyObject* args)
                           &x0, &y0, &x1, &y1, &brush, &pen))
         return NULL;
 
-    agg::path_storage path;
+    if (!draw_visible(self, agg::rect_d(x0, y0, x1, y1), pen, brush)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    agg::path_storage& path = draw_scratch(self);
     path.move_to(x0, y0);
     path.line_to(x1, y0);
     path.line_to(x1, y1);
@@ -1245,9 +2995,14 @@ draw_rounded_rectangle(DrawObject* self, PyObject* args)
                           &x0, &y0, &x1, &y1, &r, &brush, &pen))
         return NULL;
 
-    agg::path_storage path;
+    if (!draw_visible(self, agg::rect_d(x0, y0, x1, y1), pen, brush)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    agg::path_storage& path = draw_scratch(self);
     agg::rounded_rect rr(x0, y0, x1, y1, r);
-    rr.approximation_scale(1);
+    rr.approximation_scale(draw_approximation_scale(self));
     path.add_path(rr);
 
     self->draw->draw(path, pen, brush);
@@ -1264,8 +3019,9 @@ const char *draw_path_doc = "Draw the given path.\n"
                             "\n"
                             "Parameters\n"
                             "----------\n"
-                            "path : Path\n"
-                            "    Path object created by the `Path` factory.\n"
+                            "path : Path or PathGroup\n"
+                            "    Path object created by the `Path` factory, or a group\n"
+                            "    created by the `PathGroup` factory.\n"
                             "pen : Pen\n"
                             "    Optional pen object created by the `Pen` factory.\n"
                             "brush : Brush\n"
@@ -1273,11 +3029,21 @@ const char *draw_path_doc = "Draw the given path.\n"
 
 static PyObject* 
 draw_path(DrawObject* self, PyObject* args){
-    PathObject* path;
+    PyObject*   path;
     PyObject*   brush = NULL;
     PyObject*   pen   = NULL;
 
-    if (!PyArg_ParseTuple(args, "O!|OO:path", &PathType, &path, &brush, &pen)){
+    if (!PyArg_ParseTuple(args, "O|OO:path", &path, &brush, &pen)){
+        return NULL;
+    }
+
+    if (PathGroup_Check(path)) {
+        path_group_draw(self, (PathGroupObject*) path, pen, brush);
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    if (!Path_Check(path)) {
+        PyErr_SetString(PyExc_TypeError, "expected a Path or PathGroup");
         return NULL;
     }
 
@@ -1286,7 +3052,7 @@ draw_path(DrawObject* self, PyObject* args){
     //  tp(*symbol->path, transform);
     //agg::path_storage p;
     //p.add_path(tp, 0, false);
-    self->draw->draw(*path->path, pen, brush);
+    path_draw(self, (PathObject*) path, pen, brush);
   
     Py_INCREF(Py_None);
     return Py_None;
@@ -1303,45 +3069,73 @@ const char *draw_symbol_doc = "Draw a symbol at the given positions (experimenta
                               "xy : iterable\n"
                               "    A Python sequence (x, y, x, y, …).\n"
                               "symbol : Symbol\n"
-                              "    Symbol object created by the `Symbol` factory.\n"
+                              "    Symbol object created by the `Symbol` factory. A Path or\n"
+                              "    PathGroup can be used as well.\n"
                               "pen : Pen\n"
                               "    Optional pen object created by the `Pen` factory.\n"
                               "brush : Brush\n"
                               "    Optional brush object created by the `Brush` factory.\n";
 
+/* draws a copy of a path at each position, skipping copies that are
+   entirely off the canvas */
+template<class VertexSource> static void
+symbol_draw(DrawObject* self, VertexSource& source, const agg::rect_d& bbox,
+            PointF* xy, int count, PyObject* obj1, PyObject* obj2)
+{
+    for (int i = 0; i < count; i++) {
+        agg::rect_d box(bbox.x1 + xy[i].X, bbox.y1 + xy[i].Y,
+                        bbox.x2 + xy[i].X, bbox.y2 + xy[i].Y);
+        if (!bbox.is_valid() || !draw_visible(self, box, obj1, obj2))
+            continue;
+        agg::trans_affine_translation transform(xy[i].X,xy[i].Y);
+        agg::conv_transform<VertexSource, agg::trans_affine>
+            tp(source, transform);
+        agg::path_storage& p = draw_scratch(self);
+        p.add_path(tp, 0, false);
+        self->draw->draw(p, obj1, obj2);
+    }
+}
+
 static PyObject*
 draw_symbol(DrawObject* self, PyObject* args)
 {
     PyObject* xyIn;
-    PathObject* symbol;
+    PyObject* symbol;
     PyObject* brush = NULL;
     PyObject* pen = NULL;
-    if (!PyArg_ParseTuple(args, "OO!|OO:symbol",
-                          &xyIn, &PathType, &symbol, &brush, &pen))
+    if (!PyArg_ParseTuple(args, "OO|OO:symbol",
+                          &xyIn, &symbol, &brush, &pen))
+        return NULL;
+
+    if (!Path_Check(symbol) && !PathGroup_Check(symbol)) {
+        PyErr_SetString(PyExc_TypeError, "expected a Path or PathGroup");
         return NULL;
+    }
 
     int count;
-    PointF *xy = getpoints(xyIn, &count);
+    PointF *xy = getpoints(xyIn, &count, self);
     if (!xy)
         return NULL;
 
-    for (int i = 0; i < count; i++) {
-        agg::trans_affine_translation transform(xy[i].X,xy[i].Y);
-        agg::conv_transform<agg::path_storage, agg::trans_affine>
-            tp(*symbol->path, transform);
-        agg::path_storage p;
-        p.add_path(tp, 0, false);
-        self->draw->draw(p, pen, brush);
+    if (PathGroup_Check(symbol)) {
+        PathGroupObject* group = (PathGroupObject*) symbol;
+        path_group_source source(group);
+        symbol_draw(self, source, path_group_bbox(group), xy, count,
+                    pen, brush);
+    } else {
+        PathObject* path = (PathObject*) symbol;
+        if (path->compact)
+            symbol_draw(self, *path->compact, path_bbox(path), xy, count,
+                        pen, brush);
+        else
+            symbol_draw(self, *path->path, path_bbox(path), xy, count,
+                        pen, brush);
     }
 
-    delete [] xy;
-
     Py_INCREF(Py_None);
     return Py_None;
 }
 
-#if defined(HAVE_FREETYPE2)
-
 const char *draw_text_doc = "Draws a text string at the given position, using the given font.\n"
                             "\n"
                             "Parameters\n"
@@ -1350,27 +3144,32 @@ const char *draw_text_doc = "Draws a text string at the given position, using th
                             "    A two element tuple (x, y).\n"
                             "text : str\n"
                             "    String to draw.\n"
-                            "font : Font\n"
-                            "    A font object created by the Font factory.\n";
+                            "font : Font or RasterFont\n"
+                            "    A font object created by the Font or RasterFont factory.\n";
 
 static PyObject*
 draw_text(DrawObject* self, PyObject* args)
 {
     float xy[2];
     PyObject* text;
-    FontObject* font;
-    if (!PyArg_ParseTuple(args, "(ff)OO!:text", xy+0, xy+1, &text,
-                          &FontType, &font))
+    PyObject* font;
+    if (!PyArg_ParseTuple(args, "(ff)OO:text", xy+0, xy+1, &text, &font))
         return NULL;
 
-    self->draw->drawtext(xy, text, font);
+    if (RasterFont_Check(font))
+        self->draw->drawtext_raster(xy, text, (RasterFontObject*) font);
+#if defined(HAVE_FREETYPE2)
+    else if (Font_Check(font))
+        self->draw->drawtext(xy, text, (FontObject*) font);
+#endif
+    else {
+        PyErr_SetString(PyExc_TypeError, "expected Font or RasterFont");
+        return NULL;
+    }
 
     Py_INCREF(Py_None);
     return Py_None;
 }
-#endif
-
-#if defined(HAVE_FREETYPE2)
 
 const char *draw_textsize_doc = "Draws a text string at the given position, using the given font.\n"
                                 "\n"
@@ -1378,16 +3177,34 @@ const char *draw_textsize_doc = "Draws a text string at the given position, usin
                                 "----------\n"
                                 "text : str\n"
                                 "    String to get the drawn size of.\n"
-                                "font : Font\n"
-                                "    A font object created by the Font factory.\n";
+                                "font : Font or RasterFont\n"
+                                "    A font object created by the Font or RasterFont factory.\n";
 
 static PyObject*
 draw_textsize(DrawObject* self, PyObject* args)
 {
     PyObject* text;
-    FontObject* font;
-    if (!PyArg_ParseTuple(args, "OO!:text", &text, &FontType, &font))
+    PyObject* font_obj;
+    if (!PyArg_ParseTuple(args, "OO:text", &text, &font_obj))
+        return NULL;
+
+    if (RasterFont_Check(font_obj)) {
+        RasterFontObject* font = (RasterFontObject*) font_obj;
+        agg::glyph_raster_bin<agg::rgba8> glyph(font->font);
+        unsigned* codes = raster_text_codes(text, font->font);
+        double width = glyph.width(codes);
+        delete [] codes;
+        return Py_BuildValue("ff", width, glyph.height());
+    }
+
+#if defined(HAVE_FREETYPE2)
+    if (!Font_Check(font_obj)) {
+#endif
+        PyErr_SetString(PyExc_TypeError, "expected Font or RasterFont");
         return NULL;
+#if defined(HAVE_FREETYPE2)
+    }
+    FontObject* font = (FontObject*) font_obj;
 
     FT_Face face = font_load(font);
     if (!face) {
@@ -1408,8 +3225,8 @@ draw_textsize(DrawObject* self, PyObject* args)
     }
 
     return Py_BuildValue("ff", x/64.0, face->size->metrics.height/64.0);
-}
 #endif
+}
 
 const char *draw_setantialias_doc = "Control anti-aliasing (experimental).\n"
                             "\n"
@@ -1431,75 +3248,363 @@ draw_setantialias(DrawObject* self, PyObject* args)
     return Py_None;
 }
 
-const char *draw_settransform_doc = "Replace the current drawing transform (experimental).\n"
-                            "\n"
-                            "Parameters\n"
-                            "----------\n"
-                            "transform\n"
-                            "    The new transform. In the current version, this must be either\n"
-                            "    a (dx, dy) translation tuple, or a PIL-style (a, b, c, d, e, f)\n"
-                            "    affine transform tuple. If the transform is omitted, it is reset.\n"
-                            "\n"
-                            "Examples\n"
-                            "--------\n"
-                            "\n"
-                            "    >>> draw.settransform((dx, dy))\n";
+const char *draw_setclip_doc = "Limit drawing to a rectangle.\n"
+                              "\n"
+                              "Pixels outside the rectangle are left alone, and shapes that\n"
+                              "fall entirely outside of it are skipped before any path is built.\n"
+                              "\n"
+                              "Parameters\n"
+                              "----------\n"
+                              "box : tuple\n"
+                              "    A 4-element tuple (x0, y0, x1, y1) in device pixels, with the\n"
+                              "    upper left corner given first. The lower right corner is not\n"
+                              "    included, as for PIL's crop method.\n";
 
-static PyObject*
-draw_settransform(DrawObject* self, PyObject* args)
+/* adds the parts of a box that are not covered by another box */
+static void
+clip_subtract(agg::pod_deque<agg::rect, 2>& out, const agg::rect& box,
+              const agg::rect& other)
 {
-    double a=1, b=0, c=0, d=0, e=1, f=0;
-    if (!PyArg_ParseTuple(args, "|(dd):settransform", &c, &f)) {
-        PyErr_Clear();
-        if (!PyArg_ParseTuple(args, "(dddddd):settransform",
-                              &a, &b, &c, &d, &e, &f))
-            return NULL;
+    agg::rect overlap = box;
+    if (!overlap.clip(other)) {
+        out.add(box);
+        return;
     }
+    if (box.y1 < overlap.y1)
+        out.add(agg::rect(box.x1, box.y1, box.x2, overlap.y1 - 1));
+    if (overlap.y2 < box.y2)
+        out.add(agg::rect(box.x1, overlap.y2 + 1, box.x2, box.y2));
+    if (box.x1 < overlap.x1)
+        out.add(agg::rect(box.x1, overlap.y1, overlap.x1 - 1, overlap.y2));
+    if (overlap.x2 < box.x2)
+        out.add(agg::rect(overlap.x2 + 1, overlap.y1, box.x2, overlap.y2));
+}
 
-    /* PIL order: x=ax+by+c y=dx+ey+f */
-    /* AGG order: x=ax+cx+e y=bx+dy+f */
-    agg::trans_affine* transform = new agg::trans_affine(a, d, b, e, c, f);
-    if (!transform)
-        return PyErr_NoMemory();
+/* adds a box to the clip region, clamped to the canvas. the region is
+   kept as disjoint boxes, since the renderer blends a span once for each
+   box that contains it */
+static void
+draw_addclip(DrawObject* self, int x0, int y0, int x1, int y1)
+{
+    agg::rect box(x0, y0, x1 - 1, y1 - 1);
+    if (!box.clip(agg::rect(0, 0, self->xsize - 1, self->ysize - 1)))
+        return;
+    if (!self->clip.is_valid())
+        self->clip = box;
+    else {
+        if (box.x1 < self->clip.x1) self->clip.x1 = box.x1;
+        if (box.y1 < self->clip.y1) self->clip.y1 = box.y1;
+        if (box.x2 > self->clip.x2) self->clip.x2 = box.x2;
+        if (box.y2 > self->clip.y2) self->clip.y2 = box.y2;
+    }
 
-    delete self->transform;
-    self->transform = transform;
-        
-    Py_INCREF(Py_None);
-    return Py_None;
+    agg::pod_deque<agg::rect, 2> parts, rest;
+    parts.add(box);
+    unsigned i, j, n = self->clips->size();
+    for (i = 0; i < n && parts.size(); i++) {
+        rest.remove_all();
+        for (j = 0; j < parts.size(); j++)
+            clip_subtract(rest, parts[j], (*self->clips)[i]);
+        parts.remove_all();
+        for (j = 0; j < rest.size(); j++)
+            parts.add(rest[j]);
+    }
+    for (j = 0; j < parts.size(); j++)
+        self->clips->add(parts[j]);
 }
 
-const char *draw_frombytes_doc = "Copies data from a string buffer to the drawing area."
-                                 "\n"
-                                 "Parameters\n"
-                                 "----------\n"
-                                 "data : bytes\n"
-                                 "    A string containing packed image data, compatible with PIL’s tobytes method.\n";
-
 static PyObject*
-draw_frombytes(DrawObject* self, PyObject* args)
+draw_setclip(DrawObject* self, PyObject* args)
 {
-    char* data = NULL;
-    Py_ssize_t data_size;
-    if (!PyArg_ParseTuple(args, "s#:frombytes", &data, &data_size))
+    int x0, y0, x1, y1;
+    if (!PyArg_ParseTuple(args, "(iiii):setclip", &x0, &y0, &x1, &y1))
         return NULL;
 
-    if (data_size >= self->buffer_size)
-        memcpy(self->buffer_data, data, self->buffer_size);
-    else {
-        PyErr_SetString(PyExc_ValueError, "not enough data");
-        return NULL;
-    }
+    self->clips->remove_all();
+    self->clip = agg::rect(1, 1, 0, 0);
+    draw_addclip(self, x0, y0, x1, y1);
+    self->draw->setclip();
 
     Py_INCREF(Py_None);
     return Py_None;
 }
 
-const char *draw_tobytes_doc = "Copies data from the drawing area to a string.\n"
+const char *draw_addclip_doc = "Add a rectangle to the clip region.\n"
                                "\n"
-                               "Returns\n"
-                               "-------\n"
-                               "A string containing packed image data, compatible with PIL’s fromstring method.\n";
+                               "Drawing covers the union of the rectangles given to setclip and\n"
+                               "addclip. Each shape is still rasterized once, so an overlay that\n"
+                               "is shared by several panels of a figure is drawn into all of them\n"
+                               "in a single pass.\n"
+                               "\n"
+                               "Parameters\n"
+                               "----------\n"
+                               "box : tuple\n"
+                               "    A 4-element tuple (x0, y0, x1, y1), as for setclip.\n";
+
+static PyObject*
+draw_addclip_method(DrawObject* self, PyObject* args)
+{
+    int x0, y0, x1, y1;
+    if (!PyArg_ParseTuple(args, "(iiii):addclip", &x0, &y0, &x1, &y1))
+        return NULL;
+
+    draw_addclip(self, x0, y0, x1, y1);
+    self->draw->setclip();
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_resetclip_doc = "Remove the clip region set by setclip and addclip.\n";
+
+static PyObject*
+draw_resetclip(DrawObject* self, PyObject* args)
+{
+    if (!PyArg_ParseTuple(args, ":resetclip"))
+        return NULL;
+
+    self->clips->remove_all();
+    self->clip = agg::rect(1, 1, 0, 0);
+    draw_addclip(self, 0, 0, self->xsize, self->ysize);
+    self->draw->setclip();
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_setmask_doc = "Limit drawing to the inside of a shape, or to an alpha mask.\n"
+                              "\n"
+                              "Unlike setclip, the mask need not be rectangular, and its edges\n"
+                              "are antialiased. The mask is rasterized once and kept until the\n"
+                              "next call, so drawing many shapes through it is cheap.\n"
+                              "\n"
+                              "Parameters\n"
+                              "----------\n"
+                              "mask : Path, PathGroup, bytes or None\n"
+                              "    A path to fill with full coverage, given in user coordinates\n"
+                              "    (the current transform applies), or an 8-bit grayscale buffer\n"
+                              "    of exactly width * height bytes, where 0 hides a pixel and 255\n"
+                              "    leaves it alone. None removes the mask.\n";
+
+/* fills a path into the mask buffer, in device space */
+template<class VertexSource>
+static void
+mask_fill(DrawObject* self, VertexSource& vs)
+{
+    agg::pixfmt_gray8 pixf(*self->mask);
+    agg::renderer_base<agg::pixfmt_gray8> rb(pixf);
+    agg::renderer_scanline_aa_solid<agg::renderer_base<agg::pixfmt_gray8> >
+        renderer(rb);
+    agg::rasterizer_scanline_aa<> rasterizer;
+    agg::scanline_p8 scanline;
+
+    agg::conv_curve<VertexSource> curve(vs);
+    curve.approximation_scale(draw_approximation_scale(self));
+    if (self->transform) {
+        typedef agg::conv_transform<agg::conv_curve<VertexSource>,
+                                    agg::trans_affine> transformed;
+        transformed tp(curve, *self->transform);
+        agg::conv_clip_polygon<transformed> clip(tp);
+        clip.clip_box(-1, -1, self->xsize + 1, self->ysize + 1);
+        rasterizer.add_path(clip);
+    } else {
+        agg::conv_clip_polygon<agg::conv_curve<VertexSource> > clip(curve);
+        clip.clip_box(-1, -1, self->xsize + 1, self->ysize + 1);
+        rasterizer.add_path(clip);
+    }
+    renderer.color(agg::gray8(255));
+    agg::render_scanlines(rasterizer, scanline, renderer);
+}
+
+static PyObject*
+draw_setmask(DrawObject* self, PyObject* args)
+{
+    PyObject* mask;
+    if (!PyArg_ParseTuple(args, "O:setmask", &mask))
+        return NULL;
+
+    if (mask == Py_None) {
+        delete self->mask;
+        self->mask = NULL;
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    int size = self->xsize * self->ysize;
+    bool path = Path_Check(mask) || PathGroup_Check(mask);
+    Py_buffer view;
+    if (!path) {
+        if (PyObject_GetBuffer(mask, &view, PyBUF_SIMPLE) < 0) {
+            PyErr_Clear();
+            PyErr_SetString(PyExc_TypeError,
+                            "expected a Path, PathGroup, or bytes-like object");
+            return NULL;
+        }
+        if (view.len != size) {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError,
+                            "mask size does not match image size");
+            return NULL;
+        }
+    }
+
+    /* the mask buffer is allocated once, and reused by later masks */
+    if (!self->mask_data)
+        self->mask_data = new unsigned char[size];
+    if (!self->mask)
+        self->mask = new agg::rendering_buffer(
+            self->mask_data, self->xsize, self->ysize, self->xsize);
+
+    if (!path) {
+        memcpy(self->mask_data, view.buf, size);
+        PyBuffer_Release(&view);
+    } else {
+        memset(self->mask_data, 0, size);
+        if (PathGroup_Check(mask)) {
+            path_group_source source((PathGroupObject*) mask);
+            mask_fill(self, source);
+        } else if (((PathObject*) mask)->compact)
+            mask_fill(self, *((PathObject*) mask)->compact);
+        else
+            mask_fill(self, *((PathObject*) mask)->path);
+    }
+
+    self->draw->setmask();
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_settransform_doc = "Replace the current drawing transform (experimental).\n"
+                            "\n"
+                            "Parameters\n"
+                            "----------\n"
+                            "transform\n"
+                            "    The new transform. In the current version, this must be either\n"
+                            "    a (dx, dy) translation tuple, or a PIL-style (a, b, c, d, e, f)\n"
+                            "    affine transform tuple. If the transform is omitted, it is reset.\n"
+                            "\n"
+                            "Examples\n"
+                            "--------\n"
+                            "\n"
+                            "    >>> draw.settransform((dx, dy))\n";
+
+static PyObject*
+draw_settransform(DrawObject* self, PyObject* args)
+{
+    double a=1, b=0, c=0, d=0, e=1, f=0;
+    if (!PyArg_ParseTuple(args, "|(dd):settransform", &c, &f)) {
+        PyErr_Clear();
+        if (!PyArg_ParseTuple(args, "(dddddd):settransform",
+                              &a, &b, &c, &d, &e, &f))
+            return NULL;
+    }
+
+    /* PIL order: x=ax+by+c y=dx+ey+f */
+    /* AGG order: x=ax+cx+e y=bx+dy+f */
+    agg::trans_affine* transform = new agg::trans_affine(a, d, b, e, c, f);
+    if (!transform)
+        return PyErr_NoMemory();
+
+    delete self->transform;
+    self->transform = transform;
+        
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_setsimplify_doc = "Set the simplification tolerance.\n"
+                                  "\n"
+                                  "Vertices closer than the tolerance to the previous one are dropped\n"
+                                  "after the transform is applied, so that dense polylines cost no more\n"
+                                  "than the pixels they cover. Zero-length segments are always dropped.\n"
+                                  "\n"
+                                  "Parameters\n"
+                                  "----------\n"
+                                  "tolerance : float, optional\n"
+                                  "    Tolerance in device pixels. A quarter of a pixel or less is not\n"
+                                  "    visible. Default 0, which turns simplification off.\n";
+
+static PyObject*
+draw_setsimplify(DrawObject* self, PyObject* args)
+{
+    double tolerance = 0.0;
+    if (!PyArg_ParseTuple(args, "|d:setsimplify", &tolerance))
+        return NULL;
+
+    if (tolerance < 0) {
+        PyErr_SetString(PyExc_ValueError, "tolerance must not be negative");
+        return NULL;
+    }
+
+    self->simplify = tolerance;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_settolerance_doc = "Set the curve flattening tolerance.\n"
+                                   "\n"
+                                   "Curves, arcs and ellipses are flattened with a number of vertices\n"
+                                   "that follows their size on the drawing surface, after the current\n"
+                                   "transform. The tolerance scales that error bound.\n"
+                                   "\n"
+                                   "Parameters\n"
+                                   "----------\n"
+                                   "tolerance : float, optional\n"
+                                   "    Tolerance relative to the default. Larger values produce fewer\n"
+                                   "    vertices and coarser curves, smaller values smoother ones.\n"
+                                   "    Default 1.0.\n";
+
+static PyObject*
+draw_settolerance(DrawObject* self, PyObject* args)
+{
+    double tolerance = 1.0;
+    if (!PyArg_ParseTuple(args, "|d:settolerance", &tolerance))
+        return NULL;
+
+    if (!(tolerance > 0)) {
+        PyErr_SetString(PyExc_ValueError, "tolerance must be positive");
+        return NULL;
+    }
+
+    self->tolerance = tolerance;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_frombytes_doc = "Copies data from a string buffer to the drawing area."
+                                 "\n"
+                                 "Parameters\n"
+                                 "----------\n"
+                                 "data : bytes\n"
+                                 "    A string containing packed image data, compatible with PIL’s tobytes method.\n";
+
+static PyObject*
+draw_frombytes(DrawObject* self, PyObject* args)
+{
+    char* data = NULL;
+    Py_ssize_t data_size;
+    if (!PyArg_ParseTuple(args, "s#:frombytes", &data, &data_size))
+        return NULL;
+
+    if (data_size >= self->buffer_size)
+        memcpy(self->buffer_data, data, self->buffer_size);
+    else {
+        PyErr_SetString(PyExc_ValueError, "not enough data");
+        return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *draw_tobytes_doc = "Copies data from the drawing area to a string.\n"
+                               "\n"
+                               "Returns\n"
+                               "-------\n"
+                               "A string containing packed image data, compatible with PIL’s fromstring method.\n";
 
 static PyObject*
 draw_tobytes(DrawObject* self, PyObject* args)
@@ -1570,6 +3675,11 @@ draw_dealloc(DrawObject* self)
     delete self->draw;
     delete self->buffer;
     delete [] self->buffer_data;
+    delete self->scratch;
+    delete self->mask;
+    delete [] self->mask_data;
+    delete self->clips;
+    delete [] self->points;
 
     Py_XDECREF(self->background);
     Py_XDECREF(self->image);
@@ -1581,13 +3691,14 @@ static PyMethodDef draw_methods[] = {
 
     {"line", (PyCFunction) draw_line, METH_VARARGS, draw_line_doc},
     {"polygon", (PyCFunction) draw_polygon, METH_VARARGS, draw_polygon_doc},
+    {"combine", (PyCFunction) draw_combine, METH_VARARGS, draw_combine_doc},
+    {"coverage", (PyCFunction) draw_coverage, METH_VARARGS, draw_coverage_doc},
+    {"fill", (PyCFunction) draw_fill, METH_VARARGS, draw_fill_doc},
     {"rectangle", (PyCFunction) draw_rectangle, METH_VARARGS, draw_rectangle_doc},
     {"rounded_rectangle", (PyCFunction) draw_rounded_rectangle, METH_VARARGS, draw_rounded_rectangle_doc},
 
-#if defined(HAVE_FREETYPE2)
     {"text", (PyCFunction) draw_text, METH_VARARGS, draw_text_doc},
     {"textsize", (PyCFunction) draw_textsize, METH_VARARGS, draw_textsize_doc},
-#endif
 
     {"path", (PyCFunction) draw_path, METH_VARARGS, draw_path_doc},
     {"symbol", (PyCFunction) draw_symbol, METH_VARARGS, draw_symbol_doc},
@@ -1597,7 +3708,13 @@ static PyMethodDef draw_methods[] = {
     {"ellipse", (PyCFunction) draw_ellipse, METH_VARARGS, draw_ellipse_doc},
     {"pieslice", (PyCFunction) draw_pieslice, METH_VARARGS, draw_pieslice_doc},
 
+    {"setclip", (PyCFunction) draw_setclip, METH_VARARGS, draw_setclip_doc},
+    {"addclip", (PyCFunction) draw_addclip_method, METH_VARARGS, draw_addclip_doc},
+    {"resetclip", (PyCFunction) draw_resetclip, METH_VARARGS, draw_resetclip_doc},
+    {"setmask", (PyCFunction) draw_setmask, METH_VARARGS, draw_setmask_doc},
     {"settransform", (PyCFunction) draw_settransform, METH_VARARGS, draw_settransform_doc},
+    {"setsimplify", (PyCFunction) draw_setsimplify, METH_VARARGS, draw_setsimplify_doc},
+    {"settolerance", (PyCFunction) draw_settolerance, METH_VARARGS, draw_settolerance_doc},
     {"setantialias", (PyCFunction) draw_setantialias, METH_VARARGS, draw_setantialias_doc},
 
     {"flush", (PyCFunction) draw_flush, METH_VARARGS, draw_flush_doc},
@@ -1729,6 +3846,104 @@ brush_dealloc(BrushObject* self)
 }
 
 
+/* -------------------------------------------------------------------- */
+
+static const struct {
+    const char* name;
+    const agg::int8u* font;
+} raster_fonts[] = {
+    {"gse4x6", agg::gse4x6},
+    {"gse4x8", agg::gse4x8},
+    {"gse5x7", agg::gse5x7},
+    {"gse5x9", agg::gse5x9},
+    {"gse6x9", agg::gse6x9},
+    {"gse6x12", agg::gse6x12},
+    {"gse7x11", agg::gse7x11},
+    {"gse7x11_bold", agg::gse7x11_bold},
+    {"gse7x15", agg::gse7x15},
+    {"gse7x15_bold", agg::gse7x15_bold},
+    {"gse8x16", agg::gse8x16},
+    {"gse8x16_bold", agg::gse8x16_bold},
+    {"mcs11_prop", agg::mcs11_prop},
+    {"mcs11_prop_condensed", agg::mcs11_prop_condensed},
+    {"mcs12_prop", agg::mcs12_prop},
+    {"mcs13_prop", agg::mcs13_prop},
+    {"mcs5x10_mono", agg::mcs5x10_mono},
+    {"mcs5x11_mono", agg::mcs5x11_mono},
+    {"mcs6x10_mono", agg::mcs6x10_mono},
+    {"mcs6x11_mono", agg::mcs6x11_mono},
+    {"mcs7x12_mono_high", agg::mcs7x12_mono_high},
+    {"mcs7x12_mono_low", agg::mcs7x12_mono_low},
+    {"verdana12", agg::verdana12},
+    {"verdana12_bold", agg::verdana12_bold},
+    {"verdana13", agg::verdana13},
+    {"verdana13_bold", agg::verdana13_bold},
+    {"verdana14", agg::verdana14},
+    {"verdana14_bold", agg::verdana14_bold},
+    {"verdana16", agg::verdana16},
+    {"verdana16_bold", agg::verdana16_bold},
+    {"verdana17", agg::verdana17},
+    {"verdana17_bold", agg::verdana17_bold},
+    {"verdana18", agg::verdana18},
+    {"verdana18_bold", agg::verdana18_bold},
+    {NULL, NULL}
+};
+
+const char *raster_font_doc = "Create a font object from one of the built-in bitmap fonts.\n"
+                              "\n"
+                              "Raster fonts do not need FreeType, and are blitted glyph by glyph\n"
+                              "without anti-aliasing. Only the text position is transformed.\n"
+                              "\n"
+                              "Parameters\n"
+                              "----------\n"
+                              "color : tuple or str or int\n"
+                              "    Font color. This can be a color tuple (R, G, B) or (R, G, B, A), \n"
+                              "    a CSS-style color name, or a color integer (0xaarrggbb).\n"
+                              "name : str, optional\n"
+                              "    Font name, such as \"gse7x11\", \"mcs12_prop\" or \"verdana12_bold\".\n"
+                              "    Default \"gse7x11\".\n"
+                              "opacity : int, optional\n"
+                              "    Font opacity. Default 255.\n";
+
+static PyObject*
+raster_font_new(PyObject* self_, PyObject* args, PyObject* kw)
+{
+    RasterFontObject* self;
+
+    PyObject* color;
+    const char* name = "gse7x11";
+    int opacity = 255;
+    static const char* const kwlist[] = { "color", "name", "opacity", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|si:RasterFont", const_cast<char **>(kwlist),
+                                     &color, &name, &opacity))
+        return NULL;
+
+    int i;
+    for (i = 0; raster_fonts[i].name; i++)
+        if (!strcmp(raster_fonts[i].name, name))
+            break;
+    if (!raster_fonts[i].name) {
+        PyErr_Format(PyExc_ValueError, "unknown raster font \"%s\"", name);
+        return NULL;
+    }
+
+    self = PyObject_NEW(RasterFontObject, &RasterFontType);
+
+    if (self == NULL)
+        return NULL;
+
+    self->font = raster_fonts[i].font;
+    self->color = getcolor(color, opacity);
+
+    return (PyObject*) self;
+}
+
+static void
+raster_font_dealloc(RasterFontObject* self)
+{
+    PyObject_DEL(self);
+}
+
 /* -------------------------------------------------------------------- */
 
 const char *font_doc = "Create a font object from a truetype font file for use with `text` and `textsize`.\n"
@@ -1738,38 +3953,65 @@ const char *font_doc = "Create a font object from a truetype font file for use w
                        "color : tuple or str or int\n"
                        "    Font color. This can be a color tuple (R, G, B) or (R, G, B, A), \n"
                        "    a CSS-style color name, or a color integer (0xaarrggbb).\n"
-                       "file : str\n"
-                       "    Font source file.\n"
+                       "file : str or bytes\n"
+                       "    Font source file, or the contents of a font file as a bytes-like\n"
+                       "    object. The buffer is used in place and must not be modified\n"
+                       "    while fonts created from it exist.\n"
                        "size : int, optional\n"
                        "    Font size in pixels. Default 12.\n"
                        "opacity : int, optional\n"
-                       "    Font opacity. Default 255.\n";
+                       "    Font opacity. Default 255.\n"
+                       "sdf : bool, optional\n"
+                       "    Render through a signed distance field atlas that is shared\n"
+                       "    by all sizes and rotations of this font file. Default False.\n";
 
 static PyObject*
 font_new(PyObject* self_, PyObject* args, PyObject* kw)
 {
     PyObject* color;
-    char* filename;
+    PyObject* file;
     float size = 12;
     int opacity = 255;
-    static const char* const kwlist[] = { "color", "file", "size", "opacity", NULL };
-    if (!PyArg_ParseTupleAndKeywords(args, kw, "Os|fi:Font", const_cast<char **>(kwlist),
-                                     &color, &filename, &size, &opacity))
+    int sdf = 0;
+    static const char* const kwlist[] = { "color", "file", "size", "opacity", "sdf", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "OO|fii:Font", const_cast<char **>(kwlist),
+                                     &color, &file, &size, &opacity, &sdf))
         return NULL;
 
 #if defined(HAVE_FREETYPE2)
+    char* filename = NULL;
+    font_source* source = NULL;
+#ifdef IS_PY3K
+    if (PyUnicode_Check(file)) {
+#else
+    if (PyBytes_Check(file) || PyUnicode_Check(file)) {
+#endif
+        if (!PyArg_Parse(file, "s:Font", &filename))
+            return NULL;
+    } else {
+        source = font_source_get(file);
+        if (!source)
+            return NULL;
+        filename = source->key;
+    }
+
     FontObject* self = PyObject_NEW(FontObject, &FontType);
 
-    if (self == NULL)
+    if (self == NULL) {
+        font_source_release(source);
         return NULL;
+    }
 
     self->color = getcolor(color, opacity);
     self->filename = new char[strlen(filename)+1];
     strcpy(self->filename, filename);
+    self->source = source;
 
     self->height = size;
+    self->sdf = (sdf != 0);
 
     if (!font_load(self)) {
+        Py_DECREF(self);
         PyErr_SetString(PyExc_IOError, "cannot load font");
         return NULL;
     }
@@ -1786,13 +4028,34 @@ static PyMethodDef font_methods[] = {
 };
 
 #if defined(HAVE_FREETYPE2)
+/* initializes FreeType on first use. the engine checks and sets its own
+   flag, so concurrent first uses are serialized here */
+static FT_Library
+font_library(void)
+{
+    first_use_lock();
+    FT_Library library = font_engine.library();
+    first_use_unlock();
+    return library;
+}
+
 static FT_Face
 font_load(FontObject* font, bool outline)
 {
+    const char* data = NULL;
+    long size = 0;
+    if (font->source) {
+        data = (const char*) font->source->view.buf;
+        size = (long) font->source->view.len;
+    }
+
+    font_library();
     if (outline)
-        font_engine.load_font(font->filename, 0, agg::glyph_ren_outline);
+        font_engine.load_font(font->filename, 0, agg::glyph_ren_outline_flat,
+                              data, size);
     else
-        font_engine.load_font(font->filename, 0, agg::glyph_ren_native_gray8);
+        font_engine.load_font(font->filename, 0, agg::glyph_ren_native_gray8,
+                              data, size);
 
     font_engine.flip_y(1);
     font_engine.height(font->height);
@@ -1801,6 +4064,150 @@ font_load(FontObject* font, bool outline)
     // the patch should simply expose the m_cur_face variable
     return font_engine.m_cur_face;
 }
+
+static agg::font_sdf_atlas*
+sdf_atlas(FontObject* font)
+{
+    int i;
+    for (i = 0; i < sdf_atlas_count; i++)
+        if (!strcmp(sdf_atlases[i]->name(), font->filename))
+            return sdf_atlases[i];
+
+    const char* data = NULL;
+    long size = 0;
+    if (font->source) {
+        data = (const char*) font->source->view.buf;
+        size = (long) font->source->view.len;
+    }
+
+    agg::font_sdf_atlas* atlas = new agg::font_sdf_atlas(
+        font_library(), font->filename, 48, 6, data, size
+        );
+    if (!atlas->ok()) {
+        delete atlas;
+        return NULL;
+    }
+
+    if (sdf_atlas_count >= MAX_SDF_ATLASES) {
+        /* drop the oldest atlas */
+        delete sdf_atlases[0];
+        memmove(sdf_atlases, sdf_atlases + 1,
+                (MAX_SDF_ATLASES - 1) * sizeof(agg::font_sdf_atlas*));
+        sdf_atlas_count = MAX_SDF_ATLASES - 1;
+    }
+    sdf_atlases[sdf_atlas_count++] = atlas;
+    return atlas;
+}
+
+static font_source*
+font_source_get(PyObject* obj)
+{
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_SIMPLE) < 0)
+        return NULL;
+
+    /* faces use the data in place, so writable buffers are copied, and
+       later changes to them do not reach fonts that share the data */
+    if (!view.readonly) {
+        PyObject* copy = PyBytes_FromStringAndSize((const char*) view.buf,
+                                                   view.len);
+        PyBuffer_Release(&view);
+        if (!copy)
+            return NULL;
+        int error = PyObject_GetBuffer(copy, &view, PyBUF_SIMPLE);
+        Py_DECREF(copy);
+        if (error < 0)
+            return NULL;
+    }
+
+    /* the key identifies the data rather than the buffer, so that equal
+       buffers share a face, and glyph cache files stay valid across
+       processes */
+    unsigned long long hash = 14695981039346656037ULL; /* FNV-1a */
+    const unsigned char* p = (const unsigned char*) view.buf;
+    Py_ssize_t i;
+    for (i = 0; i < view.len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+
+    FONT_SOURCE_LOCK();
+
+    /* the same buffer again */
+    font_source* source;
+    for (source = font_sources; source; source = source->next)
+        if (source->view.buf == view.buf && source->view.len == view.len)
+            break;
+
+    /* equal data under the same key. data that only collides with a
+       source gets the next free key */
+    char key[80];
+    int n;
+    for (n = 0; !source; n++) {
+        sprintf(key, n ? "<memory:%08lx%08lx:%ld:%d>" : "<memory:%08lx%08lx:%ld>",
+                (unsigned long) (hash >> 32), (unsigned long) (hash & 0xffffffffUL),
+                (long) view.len, n);
+        for (source = font_sources; source; source = source->next)
+            if (!strcmp(source->key, key))
+                break;
+        if (!source)
+            break;
+        if (memcmp(source->view.buf, view.buf, view.len))
+            source = NULL;
+    }
+
+    if (source) {
+        source->refcount++;
+        FONT_SOURCE_UNLOCK();
+        PyBuffer_Release(&view);
+        return source;
+    }
+
+    source = new font_source;
+    source->key = new char[strlen(key)+1];
+    strcpy(source->key, key);
+    source->view = view;
+    source->refcount = 1;
+    source->next = font_sources;
+    font_sources = source;
+    FONT_SOURCE_UNLOCK();
+    return source;
+}
+
+static void
+font_source_release(font_source* source)
+{
+    if (!source)
+        return;
+
+    FONT_SOURCE_LOCK();
+    if (--source->refcount > 0) {
+        FONT_SOURCE_UNLOCK();
+        return;
+    }
+
+    /* drop everything that refers to the buffer before releasing it */
+    font_engine.unload_font(source->key);
+    int i;
+    for (i = 0; i < sdf_atlas_count; i++)
+        if (!strcmp(sdf_atlases[i]->name(), source->key)) {
+            delete sdf_atlases[i];
+            memmove(sdf_atlases + i, sdf_atlases + i + 1,
+                    (sdf_atlas_count - i - 1) * sizeof(agg::font_sdf_atlas*));
+            sdf_atlas_count--;
+            break;
+        }
+
+    font_source** link = &font_sources;
+    while (*link != source)
+        link = &(*link)->next;
+    *link = source->next;
+    FONT_SOURCE_UNLOCK();
+
+    PyBuffer_Release(&source->view);
+    delete [] source->key;
+    delete source;
+}
 #endif
 
 #ifdef IS_PY3K
@@ -1900,6 +4307,9 @@ static void
 font_dealloc(FontObject* self)
 {
     delete [] self->filename;
+#if defined(HAVE_FREETYPE2)
+    font_source_release(self->source);
+#endif
     PyObject_DEL(self);
 }
 
@@ -1920,6 +4330,8 @@ path_new(PyObject* self_, PyObject* args)
         return NULL;
 
     self->path = new agg::path_storage();
+    self->compact = NULL;
+    self->bbox_valid = 0;
 
     if (xyIn) {
         int count;
@@ -1937,209 +4349,291 @@ path_new(PyObject* self_, PyObject* args)
     return (PyObject*) self;
 }
 
-const char *symbol_doc = "Create a Symbol object for use with :meth:`Draw.symbol`.\n"
-                         "\n"
-                         "Parameters\n"
-                         "----------\n"
-                         "path : str\n"
-                         "    An SVG-style path descriptor. The following operators\n"
-                         "    are supported: M (move), L (line), H (horizontal line), V (vertical line),\n"
-                         "    C (cubic bezier), S (smooth cubic bezier), Q (quadratic bezier),\n"
-                         "    T (smooth quadratic bezier), and Z (close path). Use lower-case\n"
-                         "    operators for relative coordinates, upper-case for absolute coordinates.\n";
+/* SVG path data parser.  numbers are parsed without going through the C
+   locale, and everything is emitted straight into the path storage; curves
+   and arcs are kept as curves, and flattened when they are drawn */
 
-static PyObject*
-symbol_new(PyObject* self_, PyObject* args)
+static int
+svg_space(char c)
 {
-    char* path;
-    float scale = 1.0;
-    if (!PyArg_ParseTuple(args, "s|f:Symbol", &path, &scale))
-        return NULL;
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
 
-    PathObject* self = PyObject_NEW(PathObject, &PathType);
+/* skips whitespace and at most one comma */
+static const char*
+svg_skip(const char* p)
+{
+    while (svg_space(*p)) p++;
+    if (*p == ',')
+        for (p++; svg_space(*p); p++)
+            ;
+    return p;
+}
 
-    if (self == NULL)
+/* parses a number, returns NULL if there is none.  up to 18 significant
+   digits are kept exactly, so the result is correctly rounded for all
+   but very long or very large numbers */
+static const char*
+svg_number(const char* p, double* v)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const unsigned long long limit = 100000000000000000ULL;
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    bool digits = false;
+
+    bool negative = (*p == '-');
+    if (*p == '+' || *p == '-')
+        p++;
+    for (; *p >= '0' && *p <= '9'; p++, digits = true)
+        if (mantissa < limit)
+            mantissa = mantissa * 10 + (*p - '0');
+        else
+            exponent++;
+    if (*p == '.')
+        for (p++; *p >= '0' && *p <= '9'; p++, digits = true)
+            if (mantissa < limit) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+    if (!digits)
         return NULL;
 
-    self->path = new agg::path_storage();
-
-    char op = 0;
-    char *p, *q, *e;
-    double x, y, x1, y1, x2, y2;
-    bool curve = 0;
+    if (*p == 'e' || *p == 'E') {
+        /* only an exponent if digits follow, as in "1e5" but not "1em" */
+        const char* q = p + 1;
+        bool minus = (*q == '-');
+        if (*q == '+' || *q == '-')
+            q++;
+        if (*q >= '0' && *q <= '9') {
+            int e = 0;
+            for (; *q >= '0' && *q <= '9'; q++)
+                if (e < 10000)
+                    e = e * 10 + (*q - '0');
+            exponent += minus ? -e : e;
+            p = q;
+        }
+    }
 
-    p = path;
-    e = path + strlen(path);
+    double x = (double) mantissa;
+    if (exponent < 0)
+        x = (exponent >= -22) ? x / powers[-exponent] : x * pow(10.0, exponent);
+    else if (exponent > 0)
+        x = (exponent <= 22) ? x * powers[exponent] : x * pow(10.0, exponent);
+    *v = negative ? -x : x;
+    return p;
+}
 
-#define COMMA_WSP\
-    do { while (isspace(*p)) p++; if (*p == ',') p++; } while (0)
+/* parses an arc flag, which need not be separated from what follows */
+static const char*
+svg_flag(const char* p, double* v)
+{
+    if (*p != '0' && *p != '1')
+        return NULL;
+    *v = *p - '0';
+    return p + 1;
+}
 
-    /* sloppy SVG-style path parser */
-    while (p < e) {
-        while (isspace(*p))
-            p++;
+static int
+svg_parse(agg::path_storage& path, const char* p, double scale)
+{
+    char op = 0;
+    char prev = 0; /* previous command, in upper case */
+    double cx = 0, cy = 0; /* current point */
+    double sx = 0, sy = 0; /* start of the current subpath */
+    double qx = 0, qy = 0; /* last control point, for S and T */
+    bool closed = false;
+
+    for (;;) {
+        p = svg_skip(p);
         if (!*p)
             break;
-        else if (isalpha(*p)) {
+        bool repeat = true; /* no command letter, repeat the last one */
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')) {
             op = *p++;
-        } else {
-            if (!op) {
-                PyErr_Format(
-                    PyExc_ValueError, "no command at start of path"
-                    );
-                return NULL;
-            }
-            COMMA_WSP;            
+            p = svg_skip(p);
+            repeat = false;
+        } else if (!op) {
+            PyErr_SetString(PyExc_ValueError, "no command at start of path");
+            return 0;
+        }
+
+        char cmd = (op >= 'a') ? op - 'a' + 'A' : op;
+        bool rel = (op >= 'a');
+        int i, count;
+        switch (cmd) {
+        case 'Z': count = 0; break;
+        case 'H': case 'V': count = 1; break;
+        case 'M': case 'L': case 'T': count = 2; break;
+        case 'S': case 'Q': count = 4; break;
+        case 'C': count = 6; break;
+        case 'A': count = 7; break;
+        default:
+            PyErr_Format(PyExc_ValueError, "unknown path command '%c'", op);
+            return 0;
+        }
+
+        /* a truncated argument list is padded with zeros, for
+           compatibility with earlier versions.  no arguments at all is
+           an error */
+        double a[7] = { 0, 0, 0, 0, 0, 0, 0 };
+        const char* q = p;
+        for (i = 0; i < count; i++) {
+            const char* r = i ? svg_skip(q) : q;
+            if (cmd == 'A' && (i == 3 || i == 4))
+                r = svg_flag(r, &a[i]);
+            else
+                r = svg_number(r, &a[i]);
+            if (!r)
+                break;
+            q = r;
+        }
+        if ((count > 0 && i == 0) || (count == 0 && repeat)) {
+            PyErr_Format(PyExc_ValueError,
+                         "invalid arguments for command '%c'", op);
+            return 0;
         }
-        q = p; /* start of arguments */
-        switch (op) {
+        p = q;
+
+        /* after a close, drawing continues from the start of the subpath */
+        if (closed && cmd != 'M' && cmd != 'Z')
+            path.move_to(sx, sy);
+        closed = false;
+
+        double x, y, x1, y1, x2, y2;
+        switch (cmd) {
         case 'M':
-        case 'm':
-            x = strtod(p, &p) * scale; COMMA_WSP;
-            y = strtod(p, &p) * scale;
-            if (op == 'm')
-                self->path->rel_to_abs(&x, &y);
-            self->path->move_to(x, y);
-            break;
         case 'L':
-        case 'l':
-            x = strtod(p, &p) * scale; COMMA_WSP;
-            y = strtod(p, &p) * scale;
-            if (op == 'l')
-                self->path->rel_to_abs(&x, &y);
-            self->path->line_to(x, y);
+        case 'T':
+            x = a[0] * scale; y = a[1] * scale;
+            if (rel) { x += cx; y += cy; }
+            if (cmd == 'M') {
+                path.move_to(x, y);
+                sx = x; sy = y;
+                /* further coordinate pairs are implicit line commands */
+                op = rel ? 'l' : 'L';
+            } else if (cmd == 'L')
+                path.line_to(x, y);
+            else {
+                if (prev == 'Q' || prev == 'T') {
+                    qx = 2 * cx - qx; qy = 2 * cy - qy;
+                } else {
+                    qx = cx; qy = cy;
+                }
+                path.curve3(qx, qy, x, y);
+            }
             break;
-        case 'h':
         case 'H':
-            x = strtod(p, &p) * scale;
-            if (self->path->last_vertex(&x2, &y2) > 0) {
-                if (op == 'h')
-                    x += x2;
-                self->path->line_to(x, y2);
-            }
+            x = a[0] * scale + (rel ? cx : 0); y = cy;
+            path.line_to(x, y);
             break;
-        case 'v':
         case 'V':
-            y = strtod(p, &p) * scale;
-            if (self->path->last_vertex(&x2, &y2) > 0) {
-                if (op == 'v')
-                    y += y2;
-                self->path->line_to(x2, y);
-            }
+            x = cx; y = a[0] * scale + (rel ? cy : 0);
+            path.line_to(x, y);
             break;
-        case 'c':
         case 'C':
-            /* cubic bezier (postscript-style) */
-            x1 = strtod(p, &p) * scale; COMMA_WSP;
-            y1 = strtod(p, &p) * scale; COMMA_WSP;
-            x2 = strtod(p, &p) * scale; COMMA_WSP;
-            y2 = strtod(p, &p) * scale; COMMA_WSP;
-            x = strtod(p, &p) * scale; COMMA_WSP;
-            y = strtod(p, &p) * scale;
-            if (op == 'c') {
-                self->path->rel_to_abs(&x1, &y1);
-                self->path->rel_to_abs(&x2, &y2);
-                self->path->rel_to_abs(&x, &y);
-            }
-            self->path->curve4(x1, y1, x2, y2, x, y);
-            curve = true;
-            break;
-        case 's':
         case 'S':
-            /* smooth cubic bezier (postscript-style) */
-            x2 = strtod(p, &p) * scale; COMMA_WSP;
-            y2 = strtod(p, &p) * scale; COMMA_WSP;
-            x = strtod(p, &p) * scale; COMMA_WSP;
-            y = strtod(p, &p) * scale;
-            if (op == 's') {
-                self->path->rel_to_abs(&x2, &y2);
-                self->path->rel_to_abs(&x, &y);
-            }
-            if (self->path->last_vertex(&x1, &y1)) {
-                /* find control segment in previous curve */
-                double x0, y0;
-                if (self->path->prev_vertex(&x0, &y0)) {
-                    x1 += x1 - x0;
-                    y1 += y1 - y0;
-                    self->path->curve4(x1, y1, x2, y2, x, y);
-                }
-            }
-            curve = true;
-            break;
-        case 'q':
         case 'Q':
-            /* quadratic bezier (truetype-style) */
-            x1 = strtod(p, &p) * scale; COMMA_WSP;
-            y1 = strtod(p, &p) * scale; COMMA_WSP;
-            x = strtod(p, &p) * scale; COMMA_WSP;
-            y = strtod(p, &p) * scale;
-            if (op == 'q') {
-                self->path->rel_to_abs(&x1, &y1);
-                self->path->rel_to_abs(&x, &y);
+            for (i = 0; i < count; i++) {
+                a[i] *= scale;
+                if (rel)
+                    a[i] += (i & 1) ? cy : cx;
             }
-            self->path->curve3(x1, y1, x, y);
-            curve = true;
-            break;
-        case 't':
-        case 'T':
-            /* smooth quadratic bezier */
-            x = strtod(p, &p) * scale; COMMA_WSP;
-            y = strtod(p, &p) * scale;
-            if (op == 't')
-                self->path->rel_to_abs(&x, &y);
-            if (self->path->last_vertex(&x1, &y1)) {
-                /* find control segment in previous curve */
-                double x0, y0;
-                if (self->path->prev_vertex(&x0, &y0)) {
-                    x1 += x1 - x0;
-                    y1 += y1 - y0;
-                    self->path->curve3(x1, y1, x, y);
+            x = a[count-2]; y = a[count-1];
+            if (cmd == 'C') {
+                x1 = a[0]; y1 = a[1]; x2 = a[2]; y2 = a[3];
+            } else if (cmd == 'S') {
+                if (prev == 'C' || prev == 'S') {
+                    x1 = 2 * cx - qx; y1 = 2 * cy - qy;
+                } else {
+                    x1 = cx; y1 = cy;
                 }
+                x2 = a[0]; y2 = a[1];
+            } else {
+                path.curve3(a[0], a[1], x, y);
+                qx = a[0]; qy = a[1];
+                break;
             }
-            curve = true;
+            path.curve4(x1, y1, x2, y2, x, y);
+            qx = x2; qy = y2;
             break;
-        case 'Z':
-        case 'z':
-            p++;
-            self->path->end_poly();
+        case 'A':
+            x = a[5] * scale; y = a[6] * scale;
+            if (rel) { x += cx; y += cy; }
+            /* converted to cubic curves with bezier_arc_svg */
+            path.arc_to(a[0] * scale, a[1] * scale, a[2] * (M_PI / 180.0),
+                        a[3] != 0, a[4] != 0, x, y);
+            break;
+        default: /* 'Z' */
+            path.end_poly();
+            x = sx; y = sy;
+            closed = true;
             break;
-        default:
-            PyErr_Format(
-                PyExc_ValueError,
-                "unknown path command '%c'", op
-                );
-            /* FIXME: cleanup */
-            return NULL;
-        }
-        if (p == q) {
-            PyErr_Format(
-                PyExc_ValueError,
-                "invalid arguments for command '%c'", op
-                );
-            /* FIXME: cleanup */
-            return NULL;
         }
+
+        cx = x; cy = y;
+        prev = cmd;
     }
 
-    if (curve) {
-        /* expand curves */
-        agg::path_storage* path = self->path;
-        agg::conv_curve<agg::path_storage> curve(*path);
-        self->path = new agg::path_storage();
-        self->path->add_path(curve, 0, false);
-        delete path;
+    return 1;
+}
+
+const char *symbol_doc = "Create a Symbol object for use with :meth:`Draw.symbol`.\n"
+                         "\n"
+                         "Parameters\n"
+                         "----------\n"
+                         "path : str\n"
+                         "    An SVG path descriptor. The full SVG path grammar is supported:\n"
+                         "    M (move), L (line), H (horizontal line), V (vertical line),\n"
+                         "    C (cubic bezier), S (smooth cubic bezier), Q (quadratic bezier),\n"
+                         "    T (smooth quadratic bezier), A (elliptical arc), and Z (close path).\n"
+                         "    Use lower-case operators for relative coordinates, upper-case for\n"
+                         "    absolute coordinates.\n"
+                         "scale : float, optional\n"
+                         "    Scale factor applied to all coordinates. Default 1.0.\n";
+
+static PyObject*
+symbol_new(PyObject* self_, PyObject* args)
+{
+    char* path;
+    float scale = 1.0;
+    if (!PyArg_ParseTuple(args, "s|f:Symbol", &path, &scale))
+        return NULL;
+
+    PathObject* self = PyObject_NEW(PathObject, &PathType);
+
+    if (self == NULL)
+        return NULL;
+
+    self->path = new agg::path_storage();
+    self->compact = NULL;
+    self->bbox_valid = 0;
+
+    if (!svg_parse(*self->path, path, scale)) {
+        path_dealloc(self);
+        return NULL;
     }
 
     return (PyObject*) self;
 }
 
-void expandPaths(PathObject *self)
+/* returns the editable storage of a path, converting a compacted path
+   back to double precision first. the caller is about to modify the
+   path, so the cached bounding box is dropped */
+static agg::path_storage*
+path_expand(PathObject* self)
 {
-    agg::path_storage* path = self->path;
-    agg::conv_curve<agg::path_storage> curve(*path);
-    self->path = new agg::path_storage();
-    self->path->add_path(curve, 0, false);
-    delete path;
+    self->bbox_valid = 0;
+    if (self->compact) {
+        self->path = new agg::path_storage();
+        self->path->add_path(*self->compact, 0, false);
+        delete self->compact;
+        self->compact = NULL;
+    }
+    return self->path;
 }
 
 const char *path_moveto_doc = "Move the path pointer to the given location.\n"
@@ -2156,6 +4650,8 @@ path_moveto(PathObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, "dd:moveto", &x, &y))
         return NULL;
 
+    path_expand(self);
+
     self->path->move_to(x, y);
 
     Py_INCREF(Py_None);
@@ -2176,6 +4672,8 @@ path_rmoveto(PathObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, "dd:rmoveto", &x, &y))
         return NULL;
 
+    path_expand(self);
+
     self->path->rel_to_abs(&x, &y);
     self->path->move_to(x, y);
 
@@ -2197,6 +4695,8 @@ path_lineto(PathObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, "dd:lineto", &x, &y))
         return NULL;
 
+    path_expand(self);
+
     self->path->line_to(x, y);
 
     Py_INCREF(Py_None);
@@ -2219,6 +4719,8 @@ path_rlineto(PathObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, "dd:rlineto", &x, &y))
         return NULL;
 
+    path_expand(self);
+
     self->path->rel_to_abs(&x, &y);
     self->path->line_to(x, y);
 
@@ -2226,7 +4728,7 @@ path_rlineto(PathObject* self, PyObject* args)
     return Py_None;
 }
 
-const char *path_curveto_doc = "Adds a line segment to the path.\n"
+const char *path_curveto_doc = "Adds a bezier curve segment to the path.\n"
                                "\n"
                                "Parameters\n"
                                "----------\n"
@@ -2244,9 +4746,9 @@ path_curveto(PathObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, "dddddd:curveto", &x1, &y1, &x2, &y2, &x, &y))
         return NULL;
 
-    self->path->curve4(x1, y1, x2, y2, x, y);
+    path_expand(self);
 
-    expandPaths(self);
+    self->path->curve4(x1, y1, x2, y2, x, y);
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -2272,6 +4774,8 @@ path_rcurveto(PathObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, "dddddd:rcurveto", &x1, &y1, &x2, &y2, &x, &y))
         return NULL;
 
+    path_expand(self);
+
     self->path->rel_to_abs(&x1, &y1);
     self->path->rel_to_abs(&x2, &y2);
     self->path->rel_to_abs(&x, &y);
@@ -2290,13 +4794,9 @@ path_close(PathObject* self, PyObject* args)
     if (!PyArg_ParseTuple(args, ":close"))
         return NULL;
 
+    path_expand(self);
+
     self->path->close_polygon(0);
-    /* expand curves */
-    agg::path_storage* path = self->path;
-    agg::conv_curve<agg::path_storage> curve(*path);
-    self->path = new agg::path_storage();
-    self->path->add_path(curve, 0, false);
-    delete path;
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -2314,108 +4814,1268 @@ path_polygon(PathObject* self, PyObject* args)
     if (!xy)
         return NULL;
 
-    agg::path_storage path;
+    agg::path_storage* path = path_expand(self);
 
-    path.move_to(xy[0].X, xy[0].Y);
+    path->move_to(xy[0].X, xy[0].Y);
     for (int i = 1; i < count; i++)
-        path.line_to(xy[i].X, xy[i].Y);
-    path.close_polygon();
+        path->line_to(xy[i].X, xy[i].Y);
+    path->close_polygon();
     delete [] xy;
 
-    self->path->add_path(path, 0, false);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *path_clear_doc = "Removes all subpaths from the path.\n"
+                             "\n"
+                             "The memory used by the path is kept, so a path that is cleared\n"
+                             "and rebuilt for every frame stops allocating once it has reached\n"
+                             "its largest size.\n";
+
+static PyObject*
+path_clear(PathObject* self, PyObject* args)
+{
+    if (!PyArg_ParseTuple(args, ":clear"))
+        return NULL;
+
+    if (self->compact)
+        self->compact->remove_all();
+    else
+        self->path->remove_all();
+    self->bbox_valid = 0;
 
     Py_INCREF(Py_None);
     return Py_None;
 }
 
-const char *path_coords_doc = "Returns the coordinates for this path.\n"
+/* adds the vertices of a source to a path. if the source reads from the
+   path itself, it is copied first, since the path grows as it is read */
+template<class VertexSource> static void
+path_append_source(PathObject* self, VertexSource& source, bool aliased)
+{
+    agg::path_storage* path = path_expand(self);
+    if (aliased) {
+        agg::path_storage copy;
+        copy.add_path(source, 0, false);
+        path->add_path(copy, 0, false);
+    } else
+        path->add_path(source, 0, false);
+}
+
+const char *path_append_doc = "Adds the subpaths of another path to this path.\n"
+                              "\n"
+                              "The vertices are copied, so later changes to the other path do\n"
+                              "not affect this one.\n"
                               "\n"
-                              "Curves are flattened before being returned.\n";
+                              "Parameters\n"
+                              "----------\n"
+                              "path : Path or PathGroup\n"
+                              "    The path, or group of paths, to add.\n";
+
+/* adds a Path or PathGroup, which the caller has type checked */
+static void
+path_add(PathObject* self, PyObject* other)
+{
+    if (Path_Check(other)) {
+        PathObject* path = (PathObject*) other;
+        /* expand first, in case the other path is this one */
+        path_expand(self);
+        if (path->compact)
+            path_append_source(self, *path->compact, false);
+        else
+            path_append_source(self, *path->path, path == self);
+    } else if (PathGroup_Check(other)) {
+        PathGroupObject* group = (PathGroupObject*) other;
+        bool aliased = false;
+        for (int i = 0; i < group->count; i++)
+            if (group->paths[i] == self)
+                aliased = true;
+        path_expand(self);
+        path_group_source source(group);
+        path_append_source(self, source, aliased);
+    }
+}
 
 static PyObject*
-path_coords(PathObject* self, PyObject* args)
+path_append(PathObject* self, PyObject* args)
 {
-    if (!PyArg_ParseTuple(args, ":coords"))
+    PyObject* other;
+    if (!PyArg_ParseTuple(args, "O:append", &other))
         return NULL;
 
-    agg::conv_curve<agg::path_storage> curve(*self->path);
+    if (!Path_Check(other) && !PathGroup_Check(other)) {
+        PyErr_SetString(PyExc_TypeError, "expected a Path or PathGroup");
+        return NULL;
+    }
+    path_add(self, other);
 
-    curve.rewind(0);
-    curve.approximation_scale(1);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
 
-    PyObject* list;
+const char *path_extend_doc = "Adds the subpaths of several paths to this path.\n"
+                              "\n"
+                              "All paths are checked before any is added, so on error the path\n"
+                              "is left unchanged.\n"
+                              "\n"
+                              "Parameters\n"
+                              "----------\n"
+                              "paths : iterable\n"
+                              "    A Python sequence of Path or PathGroup objects.\n";
 
-    list = PyList_New(0);
-    if (!list)
+static PyObject*
+path_extend(PathObject* self, PyObject* args)
+{
+    PyObject* pathsIn;
+    if (!PyArg_ParseTuple(args, "O:extend", &pathsIn))
         return NULL;
 
-    double x, y;
-    unsigned cmd;
-    while (!agg::is_stop(cmd = curve.vertex(&x, &y))) {
-        if (agg::is_vertex(cmd)) {
-            if (PyList_Append(list, PyFloat_FromDouble(x)) < 0)
-                return NULL;
-            if (PyList_Append(list, PyFloat_FromDouble(y)) < 0)
-                return NULL;
+    PyObject* seq = PySequence_Fast(pathsIn, "expected a sequence of paths");
+    if (!seq)
+        return NULL;
+
+    Py_ssize_t i, count = PySequence_Fast_GET_SIZE(seq);
+    PyObject** items = PySequence_Fast_ITEMS(seq);
+    for (i = 0; i < count; i++)
+        if (!Path_Check(items[i]) && !PathGroup_Check(items[i])) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_TypeError, "expected a Path or PathGroup");
+            return NULL;
         }
-    }
+    for (i = 0; i < count; i++)
+        path_add(self, items[i]);
+    Py_DECREF(seq);
 
-    return list;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/* -------------------------------------------------------------------- */
+
+static ArrayObject*
+array_new(const char* format, Py_ssize_t itemsize, Py_ssize_t rows,
+          Py_ssize_t columns)
+{
+    ArrayObject* self = PyObject_NEW(ArrayObject, &ArrayType);
+    if (self == NULL)
+        return NULL;
+
+    self->data = new char[rows * columns * itemsize + 1];
+    self->format = format;
+    self->itemsize = itemsize;
+    self->ndim = (columns > 1) ? 2 : 1;
+    self->shape[0] = rows;
+    self->shape[1] = columns;
+    self->strides[0] = columns * itemsize;
+    self->strides[1] = itemsize;
+
+    return self;
+}
+
+static int
+array_getbuffer(ArrayObject* self, Py_buffer* view, int flags)
+{
+    Py_ssize_t len = self->shape[0] * self->shape[1] * self->itemsize;
+    if (PyBuffer_FillInfo(view, (PyObject*) self, self->data, len, 0,
+                          flags) < 0)
+        return -1;
+    if (flags & PyBUF_FORMAT) {
+        view->format = (char*) self->format;
+        view->itemsize = self->itemsize;
+    }
+    if (flags & PyBUF_ND) {
+        view->itemsize = self->itemsize;
+        view->ndim = self->ndim;
+        view->shape = self->shape;
+        if ((flags & PyBUF_STRIDES) == PyBUF_STRIDES)
+            view->strides = self->strides;
+    }
+    return 0;
 }
 
 static void
-path_dealloc(PathObject* self)
+array_dealloc(ArrayObject* self)
 {
-    delete self->path;
+    delete [] self->data;
     PyObject_DEL(self);
 }
 
-static PyMethodDef path_methods[] = {
+/* -------------------------------------------------------------------- */
 
-    {"lineto", (PyCFunction) path_lineto, METH_VARARGS, path_lineto_doc},
-    {"rlineto", (PyCFunction) path_rlineto, METH_VARARGS, path_rlineto_doc},
-    {"curveto", (PyCFunction) path_curveto, METH_VARARGS, path_curveto_doc},
-    {"rcurveto", (PyCFunction) path_rcurveto, METH_VARARGS, path_rcurveto_doc},
-    {"moveto", (PyCFunction) path_moveto, METH_VARARGS, path_moveto_doc},
-    {"rmoveto", (PyCFunction) path_rmoveto, METH_VARARGS, path_rmoveto_doc},
+/* grows an array that has not been exported yet, keeping its contents */
+static void
+array_grow(ArrayObject* self, Py_ssize_t rows)
+{
+    Py_ssize_t size = self->shape[0] * self->strides[0];
+    char* data = new char[rows * self->strides[0] + 1];
+    memcpy(data, self->data, size);
+    delete [] self->data;
+    self->data = data;
+    self->shape[0] = rows;
+}
 
-    {"close", (PyCFunction) path_close, METH_VARARGS, path_close_doc},
+/* flattens the curves of a path straight into an (N, 2) coordinate
+   array and an optional (N,) command array. the arrays start with one
+   row per stored vertex, which is enough unless curves add vertices;
+   they are trimmed to the vertex count, and the count is returned */
+template<class PathStorage> static Py_ssize_t
+path_flatten(PathStorage& path, double scale, ArrayObject* xy,
+             ArrayObject* cmds)
+{
+    agg::conv_curve<PathStorage> curve(path);
 
-    {"polygon", (PyCFunction) path_polygon, METH_VARARGS},
+    curve.rewind(0);
+    curve.approximation_scale(scale);
 
-    {"coords", (PyCFunction) path_coords, METH_VARARGS, path_coords_doc},
+    double x, y;
+    unsigned cmd;
+    Py_ssize_t n = 0;
+    while (!agg::is_stop(cmd = curve.vertex(&x, &y))) {
+        if (agg::is_vertex(cmd)) {
+            if (n == xy->shape[0]) {
+                array_grow(xy, 2 * n + 16);
+                if (cmds)
+                    array_grow(cmds, 2 * n + 16);
+            }
+            double* p = (double*) xy->data + 2 * n;
+            p[0] = x;
+            p[1] = y;
+            if (cmds)
+                cmds->data[n] = agg::is_move_to(cmd) ? agg::path_cmd_move_to
+                                                     : agg::path_cmd_line_to;
+            n++;
+        } else if (agg::is_close(cmd) && n && cmds)
+            cmds->data[n-1] |= agg::path_flags_close;
+    }
+    xy->shape[0] = n;
+    if (cmds)
+        cmds->shape[0] = n;
+    return n;
+}
 
-    {NULL, NULL}
-};
+const char *path_coords_doc = "Returns the coordinates for this path.\n"
+                              "\n"
+                              "Curves are flattened before being returned.\n"
+                              "\n"
+                              "Parameters\n"
+                              "----------\n"
+                              "array : bool, optional\n"
+                              "    Return a packed float64 array of shape (N, 2) that supports the\n"
+                              "    buffer protocol, instead of a flat list. Default False.\n"
+                              "commands : bool, optional\n"
+                              "    Also return the command for each vertex, as a (coords, commands)\n"
+                              "    tuple. Commands are 1 for the first vertex of a subpath and 2 for\n"
+                              "    the others. 0x40 is added to the last vertex of a closed subpath.\n"
+                              "    With array, the commands are a uint8 array of shape (N,).\n"
+                              "    Default False.\n"
+                              "tolerance : float, optional\n"
+                              "    Curve flattening tolerance relative to the default, in path\n"
+                              "    units. Pass the inverse of the scale the path will be shown at\n"
+                              "    to get a vertex count that follows the on-screen size.\n"
+                              "    Default 1.0.\n";
 
-#ifdef IS_PY3K
-static PyObject*  
-path_getattro(PathObject* self, PyObject* nameobj)
+static PyObject*
+path_coords(PathObject* self, PyObject* args, PyObject* kw)
 {
-    return PyObject_GenericGetAttr((PyObject*)self, nameobj);
+    int array = 0;
+    int commands = 0;
+    double tolerance = 1.0;
+    static const char* const kwlist[] = { "array", "commands", "tolerance", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "|iid:coords", const_cast<char **>(kwlist),
+                                     &array, &commands, &tolerance))
+        return NULL;
+
+    if (!(tolerance > 0)) {
+        PyErr_SetString(PyExc_ValueError, "tolerance must be positive");
+        return NULL;
+    }
+
+    Py_ssize_t i, n = self->compact ? self->compact->total_vertices()
+                                    : self->path->total_vertices();
+    ArrayObject* a = array_new("d", sizeof(double), n, 2);
+    if (!a)
+        return NULL;
+    ArrayObject* c = NULL;
+    if (commands) {
+        c = array_new("B", 1, n, 1);
+        if (!c) {
+            Py_DECREF(a);
+            return NULL;
+        }
+    }
+    if (self->compact)
+        n = path_flatten(*self->compact, 1.0 / tolerance, a, c);
+    else
+        n = path_flatten(*self->path, 1.0 / tolerance, a, c);
+
+    PyObject* coords = (PyObject*) a;
+    PyObject* codes = (PyObject*) c;
+
+    if (!array) {
+        /* the lists are built from the arrays */
+        const double* xy = (const double*) a->data;
+        coords = PyList_New(2*n);
+        for (i = 0; coords && i < 2*n; i++) {
+            PyObject* v = PyFloat_FromDouble(xy[i]);
+            if (!v)
+                Py_CLEAR(coords);
+            else
+                PyList_SET_ITEM(coords, i, v);
+        }
+        Py_DECREF(a);
+        if (c) {
+            codes = coords ? PyList_New(n) : NULL;
+            for (i = 0; codes && i < n; i++) {
+                PyObject* v = PyLong_FromLong((unsigned char) c->data[i]);
+                if (!v)
+                    Py_CLEAR(codes);
+                else
+                    PyList_SET_ITEM(codes, i, v);
+            }
+            Py_DECREF(c);
+            if (!codes)
+                Py_CLEAR(coords);
+        }
+        if (!coords)
+            return NULL;
+    }
+
+    if (!commands)
+        return coords;
+
+    PyObject* result = Py_BuildValue("NN", coords, codes);
+    return result;
 }
 
-#else
+const char *path_bbox_doc = "Returns the bounding box of this path.\n"
+                            "\n"
+                            "The box includes curve control points, so it may be larger than the\n"
+                            "curves themselves. It is cached until the path is modified.\n"
+                            "\n"
+                            "Returns\n"
+                            "-------\n"
+                            "tuple or None\n"
+                            "    An (x0, y0, x1, y1) tuple, or None if the path is empty.\n";
+
 static PyObject*
-path_getattr(PathObject* self, char* name)
+path_bbox_method(PathObject* self, PyObject* args)
 {
-    return Py_FindMethod(path_methods, (PyObject*) self, name);
-}
-#endif
+    if (!PyArg_ParseTuple(args, ":bbox"))
+        return NULL;
 
-/* -------------------------------------------------------------------- */
+    const agg::rect_d& bbox = path_bbox(self);
+    if (!bbox.is_valid()) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
 
-static PyMethodDef aggdraw_functions[] = {
-    {"Pen", (PyCFunction) pen_new, METH_VARARGS|METH_KEYWORDS, pen_doc},
-    {"Brush", (PyCFunction) brush_new, METH_VARARGS|METH_KEYWORDS, brush_doc},
-    {"Font", (PyCFunction) font_new, METH_VARARGS|METH_KEYWORDS, font_doc},
-    {"Symbol", (PyCFunction) symbol_new, METH_VARARGS, symbol_doc},
-    {"Path", (PyCFunction) path_new, METH_VARARGS, path_doc},
-    {"Draw", (PyCFunction) draw_new, METH_VARARGS, draw_doc},
-    {NULL, NULL}
-};
+    return Py_BuildValue("dddd", bbox.x1, bbox.y1, bbox.x2, bbox.y2);
+}
 
-const char *mod_doc = "Python interface to the Anti-Grain Graphics Drawing library\n"
+const char *path_compact_doc = "Converts the path to compact storage.\n"
+                               "\n"
+                               "Compact paths keep their vertices in single precision, which\n"
+                               "takes about half the memory. They are drawn like any other path,\n"
+                               "and convert back to double precision when they are modified.\n";
+
+static PyObject*
+path_compact(PathObject* self, PyObject* args)
+{
+    if (!PyArg_ParseTuple(args, ":compact"))
+        return NULL;
+
+    if (!self->compact) {
+        self->compact = new agg::path_storage_float();
+        self->compact->add_path(*self->path);
+        delete self->path;
+        self->path = NULL;
+        self->bbox_valid = 0;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/* applies an affine transform to all vertices of a path, including curve
+   control points, in place */
+template<class PathStorage> static void
+path_apply(PathStorage& path, const agg::trans_affine& mtx)
+{
+    double x, y;
+    unsigned i, n = path.total_vertices();
+    for (i = 0; i < n; i++) {
+        if (agg::is_vertex(path.vertex(i, &x, &y))) {
+            mtx.transform(&x, &y);
+            path.modify_vertex(i, x, y);
+        }
+    }
+}
+
+/* copies all vertices of a path to (or from, if load is set) a packed
+   array of x, y pairs. returns the number of vertices */
+template<class PathStorage> static unsigned
+path_exchange(PathStorage& path, double* xy, bool load)
+{
+    double x, y;
+    unsigned i, n = path.total_vertices(), count = 0;
+    for (i = 0; i < n; i++) {
+        if (agg::is_vertex(path.vertex(i, &x, &y))) {
+            if (xy && load)
+                path.modify_vertex(i, xy[0], xy[1]);
+            else if (xy) {
+                xy[0] = x;
+                xy[1] = y;
+            }
+            if (xy)
+                xy += 2;
+            count++;
+        }
+    }
+    return count;
+}
+
+static PyObject*
+path_transform_func(PathObject* self, PyObject* func)
+{
+    unsigned n = self->compact ? path_exchange(*self->compact, NULL, false)
+                               : path_exchange(*self->path, NULL, false);
+
+    ArrayObject* array = array_new("d", sizeof(double), n, 2);
+    if (!array)
+        return NULL;
+    double* xy = (double*) array->data;
+    if (self->compact)
+        path_exchange(*self->compact, xy, false);
+    else
+        path_exchange(*self->path, xy, false);
+
+    PyObject* result = PyObject_CallFunctionObjArgs(func, array, NULL);
+    if (!result) {
+        Py_DECREF(array);
+        return NULL;
+    }
+
+    /* the function either updates the array in place, or returns a new
+       buffer with the same shape */
+    Py_buffer view;
+    view.buf = NULL;
+    if (result != Py_None) {
+        if (PyObject_GetBuffer(result, &view, PyBUF_C_CONTIGUOUS|PyBUF_FORMAT) < 0) {
+            Py_DECREF(result);
+            Py_DECREF(array);
+            return NULL;
+        }
+        if (!view.format || strcmp(view.format, "d") != 0 ||
+            view.len != (Py_ssize_t) (2 * n * sizeof(double))) {
+            PyErr_Format(PyExc_ValueError,
+                         "expected %u float64 coordinate pairs", n);
+            PyBuffer_Release(&view);
+            Py_DECREF(result);
+            Py_DECREF(array);
+            return NULL;
+        }
+        xy = (double*) view.buf;
+    }
+
+    /* the function may have changed the path itself */
+    unsigned count = self->compact ? path_exchange(*self->compact, NULL, false)
+                                   : path_exchange(*self->path, NULL, false);
+    if (count != n) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "path changed size during transform");
+        if (view.buf)
+            PyBuffer_Release(&view);
+        Py_DECREF(result);
+        Py_DECREF(array);
+        return NULL;
+    }
+
+    if (self->compact)
+        path_exchange(*self->compact, xy, true);
+    else
+        path_exchange(*self->path, xy, true);
+    self->bbox_valid = 0;
+
+    if (view.buf)
+        PyBuffer_Release(&view);
+    Py_DECREF(result);
+    Py_DECREF(array);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *path_transform_doc = "Transforms the path in place.\n"
+                                 "\n"
+                                 "All vertices are updated in a single pass, including curve control\n"
+                                 "points. Compact paths stay compact.\n"
+                                 "\n"
+                                 "Parameters\n"
+                                 "----------\n"
+                                 "transform\n"
+                                 "    Either a (dx, dy) translation tuple, a PIL-style (a, b, c, d, e, f)\n"
+                                 "    affine transform tuple, or a function. The function is called\n"
+                                 "    with a writable float64 array of shape (N, 2) holding all\n"
+                                 "    vertices. It can update the array in place and return None, or\n"
+                                 "    return a new buffer of the same shape and type.\n";
+
+static PyObject*
+path_transform(PathObject* self, PyObject* args)
+{
+    PyObject* func;
+    if (PyArg_ParseTuple(args, "O:transform", &func) && PyCallable_Check(func))
+        return path_transform_func(self, func);
+
+    double a=1, b=0, c=0, d=0, e=1, f=0;
+    if (!PyArg_ParseTuple(args, "(dd):transform", &c, &f)) {
+        PyErr_Clear();
+        if (!PyArg_ParseTuple(args, "(dddddd):transform",
+                              &a, &b, &c, &d, &e, &f))
+            return NULL;
+    }
+
+    /* PIL order, as in settransform */
+    agg::trans_affine mtx(a, d, b, e, c, f);
+    if (self->compact)
+        path_apply(*self->compact, mtx);
+    else
+        path_apply(*self->path, mtx);
+    self->bbox_valid = 0;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/* binary path format: a 12-byte header, one command byte per vertex,
+   padding to a multiple of 8 bytes, then the packed x, y pairs in native
+   byte order.  the byte order mark catches files from other machines */
+
+#define PATH_MAGIC "AGGP"
+#define PATH_VERSION 1
+#define PATH_FLOAT32 1
+#define PATH_BYTEORDER 0x0102
+
+typedef struct {
+    char magic[4];
+    agg::int8u version;
+    agg::int8u flags;
+    agg::int16u byteorder;
+    agg::int32u count;
+} path_header;
+
+static size_t
+path_data_offset(size_t count)
+{
+    return (sizeof(path_header) + count + 7) & ~(size_t) 7;
+}
+
+template<class PathStorage, class T> static void
+path_serialize(PathStorage& path, char* data)
+{
+    unsigned i, n = path.total_vertices();
+    agg::int8u* cmds = (agg::int8u*) data + sizeof(path_header);
+    T* xy = (T*) (data + path_data_offset(n));
+    double x, y;
+    for (i = 0; i < n; i++) {
+        cmds[i] = (agg::int8u) path.vertex(i, &x, &y);
+        xy[2*i] = (T) x;
+        xy[2*i+1] = (T) y;
+    }
+}
+
+template<class PathStorage, class T> static void
+path_deserialize(PathStorage& path, const char* data, unsigned n)
+{
+    const agg::int8u* cmds = (const agg::int8u*) data + sizeof(path_header);
+    const T* xy = (const T*) (data + path_data_offset(n));
+    for (unsigned i = 0; i < n; i++)
+        path.add_vertex(xy[2*i], xy[2*i+1], cmds[i]);
+}
+
+const char *path_tobytes_doc = "Serializes the path to a compact binary string.\n"
+                               "\n"
+                               "Parameters\n"
+                               "----------\n"
+                               "float32 : bool, optional\n"
+                               "    Store coordinates in single precision. Compact paths are always\n"
+                               "    stored in single precision. Default False.\n"
+                               "\n"
+                               "Returns\n"
+                               "-------\n"
+                               "bytes\n"
+                               "    Data that can be passed to `path_frombytes`.\n";
+
+static PyObject*
+path_tobytes(PathObject* self, PyObject* args, PyObject* kw)
+{
+    int float32 = 0;
+    static const char* const kwlist[] = { "float32", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "|i:tobytes", const_cast<char **>(kwlist),
+                                     &float32))
+        return NULL;
+
+    if (self->compact)
+        float32 = 1;
+
+    unsigned n = self->compact ? self->compact->total_vertices()
+                               : self->path->total_vertices();
+    size_t itemsize = float32 ? sizeof(float) : sizeof(double);
+    size_t size = path_data_offset(n) + 2 * n * itemsize;
+
+    PyObject* bytes = PyBytes_FromStringAndSize(NULL, size);
+    if (!bytes)
+        return NULL;
+    char* data = PyBytes_AS_STRING(bytes);
+    memset(data, 0, path_data_offset(n));
+
+    path_header header;
+    memcpy(header.magic, PATH_MAGIC, 4);
+    header.version = PATH_VERSION;
+    header.flags = float32 ? PATH_FLOAT32 : 0;
+    header.byteorder = PATH_BYTEORDER;
+    header.count = n;
+    memcpy(data, &header, sizeof(header));
+
+    if (self->compact)
+        path_serialize<agg::path_storage_float, float>(*self->compact, data);
+    else if (float32)
+        path_serialize<agg::path_storage, float>(*self->path, data);
+    else
+        path_serialize<agg::path_storage, double>(*self->path, data);
+
+    return bytes;
+}
+
+const char *path_frombytes_doc = "Creates a path from data returned by `Path.tobytes`.\n"
+                                 "\n"
+                                 "Single precision data gives a compact path.\n"
+                                 "\n"
+                                 "Parameters\n"
+                                 "----------\n"
+                                 "data : bytes\n"
+                                 "    A bytes-like object.\n";
+
+static PyObject*
+path_frombytes(PyObject* self_, PyObject* args)
+{
+    Py_buffer view;
+    if (!PyArg_ParseTuple(args, "y*:path_frombytes", &view))
+        return NULL;
+
+    const char* data = (const char*) view.buf;
+    path_header header;
+    unsigned i, n = 0;
+    bool ok = view.len >= (Py_ssize_t) sizeof(header);
+    if (ok) {
+        memcpy(&header, data, sizeof(header));
+        n = header.count;
+        ok = !memcmp(header.magic, PATH_MAGIC, 4) &&
+             header.version == PATH_VERSION &&
+             header.byteorder == PATH_BYTEORDER &&
+             (header.flags & ~PATH_FLOAT32) == 0;
+    }
+    size_t itemsize = (ok && (header.flags & PATH_FLOAT32)) ? sizeof(float)
+                                                             : sizeof(double);
+    if (ok)
+        ok = (size_t) view.len == path_data_offset(n) + 2 * (size_t) n * itemsize;
+    for (i = 0; ok && i < n; i++) {
+        unsigned cmd = ((const agg::int8u*) data)[sizeof(header) + i];
+        ok = (agg::is_vertex(cmd) && (cmd & ~agg::path_cmd_mask) == 0) ||
+             agg::is_end_poly(cmd);
+    }
+    if (!ok) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "invalid path data");
+        return NULL;
+    }
+
+    PathObject* self = PyObject_NEW(PathObject, &PathType);
+    if (self == NULL) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    self->path = NULL;
+    self->compact = NULL;
+    self->bbox_valid = 0;
+
+    /* the coordinate arrays must be aligned; copy the data if they
+       are not */
+    char* copy = NULL;
+    if ((size_t) data & 7) {
+        copy = new char[view.len];
+        memcpy(copy, data, view.len);
+        data = copy;
+    }
+
+    if (itemsize == sizeof(float)) {
+        self->compact = new agg::path_storage_float();
+        path_deserialize<agg::path_storage_float, float>(*self->compact, data, n);
+    } else {
+        self->path = new agg::path_storage();
+        path_deserialize<agg::path_storage, double>(*self->path, data, n);
+    }
+    delete [] copy;
+    PyBuffer_Release(&view);
+
+    return (PyObject*) self;
+}
+
+static void
+path_dealloc(PathObject* self)
+{
+    delete self->path;
+    delete self->compact;
+    PyObject_DEL(self);
+}
+
+static PyMethodDef path_methods[] = {
+
+    {"lineto", (PyCFunction) path_lineto, METH_VARARGS, path_lineto_doc},
+    {"rlineto", (PyCFunction) path_rlineto, METH_VARARGS, path_rlineto_doc},
+    {"curveto", (PyCFunction) path_curveto, METH_VARARGS, path_curveto_doc},
+    {"rcurveto", (PyCFunction) path_rcurveto, METH_VARARGS, path_rcurveto_doc},
+    {"moveto", (PyCFunction) path_moveto, METH_VARARGS, path_moveto_doc},
+    {"rmoveto", (PyCFunction) path_rmoveto, METH_VARARGS, path_rmoveto_doc},
+
+    {"close", (PyCFunction) path_close, METH_VARARGS, path_close_doc},
+
+    {"polygon", (PyCFunction) path_polygon, METH_VARARGS},
+    {"append", (PyCFunction) path_append, METH_VARARGS, path_append_doc},
+    {"extend", (PyCFunction) path_extend, METH_VARARGS, path_extend_doc},
+    {"clear", (PyCFunction) path_clear, METH_VARARGS, path_clear_doc},
+
+    {"bbox", (PyCFunction) path_bbox_method, METH_VARARGS, path_bbox_doc},
+    {"coords", (PyCFunction) path_coords, METH_VARARGS|METH_KEYWORDS, path_coords_doc},
+    {"compact", (PyCFunction) path_compact, METH_VARARGS, path_compact_doc},
+    {"tobytes", (PyCFunction) path_tobytes, METH_VARARGS|METH_KEYWORDS, path_tobytes_doc},
+    {"transform", (PyCFunction) path_transform, METH_VARARGS, path_transform_doc},
+
+    {NULL, NULL}
+};
+
+#ifdef IS_PY3K
+static PyObject*  
+path_getattro(PathObject* self, PyObject* nameobj)
+{
+    return PyObject_GenericGetAttr((PyObject*)self, nameobj);
+}
+
+#else
+static PyObject*
+path_getattr(PathObject* self, char* name)
+{
+    return Py_FindMethod(path_methods, (PyObject*) self, name);
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+
+const char *path_group_doc = "Creates a group of paths that is drawn as a single path.\n"
+                             "\n"
+                             "The group refers to the paths rather than copying them, so\n"
+                             "changes to the paths show up when the group is drawn.\n"
+                             "\n"
+                             "Parameters\n"
+                             "----------\n"
+                             "paths : iterable\n"
+                             "    A sequence of Path or PathGroup objects. Groups are merged\n"
+                             "    into the new group.\n";
+
+static PyObject*
+path_group_new(PyObject* self_, PyObject* args)
+{
+    PyObject* pathsIn;
+    if (!PyArg_ParseTuple(args, "O:PathGroup", &pathsIn))
+        return NULL;
+
+    PyObject* seq = PySequence_Fast(pathsIn, "expected a sequence of paths");
+    if (!seq)
+        return NULL;
+
+    Py_ssize_t i, n = PySequence_Fast_GET_SIZE(seq);
+    Py_ssize_t count = 0;
+    for (i = 0; i < n; i++) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        if (Path_Check(item))
+            count++;
+        else if (PathGroup_Check(item))
+            count += ((PathGroupObject*) item)->count;
+        else {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_TypeError, "expected a sequence of paths");
+            return NULL;
+        }
+    }
+
+    PathGroupObject* self = PyObject_NEW(PathGroupObject, &PathGroupType);
+    if (self == NULL) {
+        Py_DECREF(seq);
+        return NULL;
+    }
+
+    self->paths = new PathObject*[count + 1];
+    self->count = 0;
+    for (i = 0; i < n; i++) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        if (Path_Check(item))
+            self->paths[self->count++] = (PathObject*) item;
+        else {
+            PathGroupObject* group = (PathGroupObject*) item;
+            for (int j = 0; j < group->count; j++)
+                self->paths[self->count++] = group->paths[j];
+        }
+    }
+    for (i = 0; i < self->count; i++)
+        Py_INCREF(self->paths[i]);
+
+    Py_DECREF(seq);
+
+    return (PyObject*) self;
+}
+
+const char *path_group_bbox_doc = "Returns the bounding box of all paths in the group.\n"
+                                  "\n"
+                                  "Returns\n"
+                                  "-------\n"
+                                  "tuple or None\n"
+                                  "    An (x0, y0, x1, y1) tuple, or None if all paths are empty.\n";
+
+static PyObject*
+path_group_bbox_method(PathGroupObject* self, PyObject* args)
+{
+    if (!PyArg_ParseTuple(args, ":bbox"))
+        return NULL;
+
+    agg::rect_d bbox = path_group_bbox(self);
+    if (!bbox.is_valid()) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    return Py_BuildValue("dddd", bbox.x1, bbox.y1, bbox.x2, bbox.y2);
+}
+
+static void
+path_group_dealloc(PathGroupObject* self)
+{
+    for (int i = 0; i < self->count; i++)
+        Py_DECREF(self->paths[i]);
+    delete [] self->paths;
+    PyObject_DEL(self);
+}
+
+static PyMethodDef path_group_methods[] = {
+    {"bbox", (PyCFunction) path_group_bbox_method, METH_VARARGS,
+     path_group_bbox_doc},
+    {NULL, NULL}
+};
+
+#ifdef IS_PY3K
+static PyObject*
+path_group_getattro(PathGroupObject* self, PyObject* nameobj)
+{
+    return PyObject_GenericGetAttr((PyObject*)self, nameobj);
+}
+
+#else
+static PyObject*
+path_group_getattr(PathGroupObject* self, char* name)
+{
+    return Py_FindMethod(path_group_methods, (PyObject*) self, name);
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+
+#define COVERAGE_MAGIC "AGGC"
+#define COVERAGE_VERSION 1
+
+/* checks that serialized scanline data can be replayed safely: every
+   scanline lies within the bounds, and its spans are in order and do
+   not overlap, so that they fit in a scanline reset to those bounds */
+static bool
+coverage_valid(const agg::int8u* data, size_t size)
+{
+    if (size == 0)
+        return true;
+    if (size < 8)
+        return false;
+
+    agg::int16 v[4];
+    memcpy(v, data, sizeof(v));
+    if (v[0] > v[2] || v[1] > v[3])
+        return false;
+
+    const agg::int8u* p = data + 8;
+    const agg::int8u* end = data + size;
+    while (p < end) {
+        agg::int16 head[3]; /* size, y, number of spans */
+        if (end - p < (int) sizeof(head))
+            return false;
+        memcpy(head, p, sizeof(head));
+        if (head[1] < v[1] || head[1] > v[3] || head[2] <= 0)
+            return false;
+        const agg::int8u* q = p + sizeof(head);
+        int next = v[0];
+        for (int i = 0; i < head[2]; i++) {
+            agg::int16 span[2]; /* x, length (negative for a solid span) */
+            if (end - q < (int) sizeof(span))
+                return false;
+            memcpy(span, q, sizeof(span));
+            q += sizeof(span);
+            int len = span[1] < 0 ? -span[1] : span[1];
+            int covers = span[1] < 0 ? 1 : span[1];
+            if (len == 0 || span[0] < next || span[0] + len - 1 > v[2] ||
+                end - q < covers)
+                return false;
+            next = span[0] + len;
+            q += covers;
+        }
+        if ((agg::int16u) (q - p) != (agg::int16u) head[0])
+            return false;
+        p = q;
+    }
+    return true;
+}
+
+const char *coverage_bbox_doc = "Returns the bounding box of the coverage.\n"
+                                "\n"
+                                "Returns\n"
+                                "-------\n"
+                                "tuple or None\n"
+                                "    An (x0, y0, x1, y1) tuple in device pixels, with the lower\n"
+                                "    right corner not included, or None if the coverage is empty.\n";
+
+static PyObject*
+coverage_bbox_method(CoverageObject* self, PyObject* args)
+{
+    if (!PyArg_ParseTuple(args, ":bbox"))
+        return NULL;
+
+    agg::rect box;
+    if (!coverage_bbox(self, box)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    return Py_BuildValue("iiii", box.x1, box.y1, box.x2 + 1, box.y2 + 1);
+}
+
+const char *coverage_nbytes_doc = "Returns the memory used by the stored scanlines, in bytes.\n";
+
+static PyObject*
+coverage_nbytes(CoverageObject* self, PyObject* args)
+{
+    if (!PyArg_ParseTuple(args, ":nbytes"))
+        return NULL;
+
+    return PyLong_FromLong(self->size);
+}
+
+const char *coverage_tobytes_doc = "Serializes the coverage to a binary string.\n"
+                                   "\n"
+                                   "Returns\n"
+                                   "-------\n"
+                                   "bytes\n"
+                                   "    Data that can be passed to `coverage_frombytes`.\n";
+
+static PyObject*
+coverage_tobytes(CoverageObject* self, PyObject* args)
+{
+    if (!PyArg_ParseTuple(args, ":tobytes"))
+        return NULL;
+
+    PyObject* bytes = PyBytes_FromStringAndSize(NULL,
+                                                sizeof(path_header) + self->size);
+    if (!bytes)
+        return NULL;
+    char* data = PyBytes_AS_STRING(bytes);
+
+    /* same header as for paths; the count is the size of the data */
+    path_header header;
+    memcpy(header.magic, COVERAGE_MAGIC, 4);
+    header.version = COVERAGE_VERSION;
+    header.flags = 0;
+    header.byteorder = PATH_BYTEORDER;
+    header.count = self->size;
+    memcpy(data, &header, sizeof(header));
+    if (self->size)
+        memcpy(data + sizeof(header), self->data, self->size);
+
+    return bytes;
+}
+
+const char *coverage_frombytes_doc = "Creates a coverage from data returned by `Coverage.tobytes`.\n"
+                                     "\n"
+                                     "Parameters\n"
+                                     "----------\n"
+                                     "data : bytes\n"
+                                     "    A bytes-like object.\n";
+
+static PyObject*
+coverage_frombytes(PyObject* self_, PyObject* args)
+{
+    Py_buffer view;
+    if (!PyArg_ParseTuple(args, "y*:coverage_frombytes", &view))
+        return NULL;
+
+    const char* data = (const char*) view.buf;
+    path_header header;
+    bool ok = view.len >= (Py_ssize_t) sizeof(header);
+    if (ok) {
+        memcpy(&header, data, sizeof(header));
+        ok = !memcmp(header.magic, COVERAGE_MAGIC, 4) &&
+             header.version == COVERAGE_VERSION &&
+             header.byteorder == PATH_BYTEORDER &&
+             header.flags == 0 &&
+             (size_t) view.len == sizeof(header) + header.count;
+    }
+    if (ok)
+        ok = coverage_valid((const agg::int8u*) data + sizeof(header),
+                            header.count);
+    if (!ok) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "invalid coverage data");
+        return NULL;
+    }
+
+    CoverageObject* self = PyObject_NEW(CoverageObject, &CoverageType);
+    if (self == NULL) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    self->size = header.count;
+    self->data = NULL;
+    if (self->size) {
+        self->data = new agg::int8u[self->size];
+        memcpy(self->data, data + sizeof(header), self->size);
+    }
+    PyBuffer_Release(&view);
+
+    return (PyObject*) self;
+}
+
+static void
+coverage_dealloc(CoverageObject* self)
+{
+    delete [] self->data;
+    PyObject_DEL(self);
+}
+
+static PyMethodDef coverage_methods[] = {
+    {"bbox", (PyCFunction) coverage_bbox_method, METH_VARARGS,
+     coverage_bbox_doc},
+    {"nbytes", (PyCFunction) coverage_nbytes, METH_VARARGS,
+     coverage_nbytes_doc},
+    {"tobytes", (PyCFunction) coverage_tobytes, METH_VARARGS,
+     coverage_tobytes_doc},
+    {NULL, NULL}
+};
+
+#ifdef IS_PY3K
+static PyObject*
+coverage_getattro(CoverageObject* self, PyObject* nameobj)
+{
+    return PyObject_GenericGetAttr((PyObject*)self, nameobj);
+}
+
+#else
+static PyObject*
+coverage_getattr(CoverageObject* self, char* name)
+{
+    return Py_FindMethod(coverage_methods, (PyObject*) self, name);
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+
+#if defined(HAVE_FREETYPE2)
+
+const char *save_glyph_cache_doc = "Writes all cached glyphs to a glyph cache file.\n"
+                                   "\n"
+                                   "Parameters\n"
+                                   "----------\n"
+                                   "filename : str\n"
+                                   "    Name of the cache file to create.\n";
+
+static PyObject*
+aggdraw_save_glyph_cache(PyObject* self_, PyObject* args)
+{
+    char* filename;
+    if (!PyArg_ParseTuple(args, "s:save_glyph_cache", &filename))
+        return NULL;
+
+    unsigned size = font_manager.cache_byte_size();
+    agg::int8u* data = new agg::int8u[size];
+    font_manager.save_cache(data);
+
+    /* write to a temporary file and rename it over the target, so that
+       processes which have the old file mapped keep valid pages. the
+       temporary name is unique and created exclusively, so concurrent
+       savers never write to the same file */
+    static unsigned temp_counter = 0;
+    char* temp = new char[strlen(filename) + 32];
+    FILE* fp = NULL;
+    for (int tries = 0; !fp && tries < 100; tries++) {
+#if defined(_MSC_VER)
+        sprintf(temp, "%s.%d.%u.tmp", filename, _getpid(), temp_counter++);
+        int fd = _open(temp, _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY,
+                       _S_IREAD | _S_IWRITE);
+        if (fd >= 0 && !(fp = _fdopen(fd, "wb"))) {
+            _close(fd);
+            remove(temp);
+            break;
+        }
+#else
+        sprintf(temp, "%s.%d.%u.tmp", filename, (int) getpid(), temp_counter++);
+        int fd = open(temp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd >= 0 && !(fp = fdopen(fd, "wb"))) {
+            close(fd);
+            remove(temp);
+            break;
+        }
+#endif
+        if (fd < 0 && errno != EEXIST)
+            break;
+    }
+    if (!fp) {
+        delete [] data;
+        delete [] temp;
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
+    }
+    size_t written = fwrite(data, 1, size, fp);
+    int error = fclose(fp);
+    delete [] data;
+#if defined(_MSC_VER)
+    if (written == size && !error)
+        error = !MoveFileExA(temp, filename, MOVEFILE_REPLACE_EXISTING);
+#else
+    if (written == size && !error)
+        error = rename(temp, filename);
+#endif
+    if (written != size || error) {
+        PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
+        remove(temp);
+        delete [] temp;
+        return NULL;
+    }
+    delete [] temp;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+const char *load_glyph_cache_doc = "Adds the glyphs in a glyph cache file to the glyph cache.\n"
+                                   "\n"
+                                   "The file is memory mapped read-only, so the glyph data is\n"
+                                   "shared by all processes that load the same file. Fonts that\n"
+                                   "are already cached are not replaced.\n"
+                                   "\n"
+                                   "Parameters\n"
+                                   "----------\n"
+                                   "filename : str\n"
+                                   "    Name of a file written by save_glyph_cache.\n";
+
+static PyObject*
+aggdraw_load_glyph_cache(PyObject* self_, PyObject* args)
+{
+    char* filename;
+    if (!PyArg_ParseTuple(args, "s:load_glyph_cache", &filename))
+        return NULL;
+
+    /* the font cache refers to the mapping, so it is kept for as long as
+       the process runs, unless no font was added from it */
+    const agg::int8u* data;
+    unsigned size;
+#if defined(_MSC_VER)
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return PyErr_SetFromWindowsErrWithFilename(0, filename);
+    DWORD high = 0;
+    size = GetFileSize(file, &high);
+    if (size == INVALID_FILE_SIZE || high) {
+        CloseHandle(file);
+        PyErr_SetString(PyExc_ValueError, "bad glyph cache file");
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+        return PyErr_SetFromWindowsErrWithFilename(0, filename);
+    data = (const agg::int8u*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+        return PyErr_SetFromWindowsErrWithFilename(0, filename);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, filename);
+    }
+    if (st.st_size < 0 || (unsigned long long) st.st_size > UINT_MAX) {
+        close(fd);
+        PyErr_SetString(PyExc_ValueError, "bad glyph cache file");
+        return NULL;
+    }
+    size = (unsigned) st.st_size;
+    void* map = size ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        PyErr_SetString(PyExc_ValueError, "bad glyph cache file");
+        return NULL;
+    }
+    data = (const agg::int8u*) map;
+#endif
+
+    int added = font_manager.load_cache(data, size);
+    if (added <= 0) {
+#if defined(_MSC_VER)
+        UnmapViewOfFile(data);
+#else
+        munmap((void*) data, size);
+#endif
+    }
+    if (added < 0) {
+        PyErr_SetString(PyExc_ValueError, "bad glyph cache file");
+        return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+#endif
+
+/* -------------------------------------------------------------------- */
+
+static PyMethodDef aggdraw_functions[] = {
+    {"Pen", (PyCFunction) pen_new, METH_VARARGS|METH_KEYWORDS, pen_doc},
+    {"Brush", (PyCFunction) brush_new, METH_VARARGS|METH_KEYWORDS, brush_doc},
+    {"Font", (PyCFunction) font_new, METH_VARARGS|METH_KEYWORDS, font_doc},
+    {"RasterFont", (PyCFunction) raster_font_new, METH_VARARGS|METH_KEYWORDS,
+     raster_font_doc},
+    {"Symbol", (PyCFunction) symbol_new, METH_VARARGS, symbol_doc},
+    {"Path", (PyCFunction) path_new, METH_VARARGS, path_doc},
+    {"path_frombytes", (PyCFunction) path_frombytes, METH_VARARGS,
+     path_frombytes_doc},
+    {"PathGroup", (PyCFunction) path_group_new, METH_VARARGS, path_group_doc},
+    {"coverage_frombytes", (PyCFunction) coverage_frombytes, METH_VARARGS,
+     coverage_frombytes_doc},
+    {"Draw", (PyCFunction) draw_new, METH_VARARGS, draw_doc},
+#if defined(HAVE_FREETYPE2)
+    {"save_glyph_cache", (PyCFunction) aggdraw_save_glyph_cache, METH_VARARGS,
+     save_glyph_cache_doc},
+    {"load_glyph_cache", (PyCFunction) aggdraw_load_glyph_cache, METH_VARARGS,
+     load_glyph_cache_doc},
+#endif
+    {NULL, NULL}
+};
+
+const char *mod_doc = "Python interface to the Anti-Grain Graphics Drawing library\n"
                       "\n"
                       "The aggdraw module implements the basic WCK 2D Drawing Interface on top\n"
                       "of `the AGG library <http://www.antigrain.com/>`_. This library supports\n"
@@ -2467,6 +6127,14 @@ aggdraw_init(void)
     DrawType.tp_methods = draw_methods;
     FontType.tp_methods = font_methods;
     PathType.tp_methods = path_methods;
+    PathGroupType.tp_methods = path_group_methods;
+    CoverageType.tp_methods = coverage_methods;
+    if (PyType_Ready(&ArrayType) < 0)
+        return NULL;
+    if (PyType_Ready(&PathGroupType) < 0)
+        return NULL;
+    if (PyType_Ready(&CoverageType) < 0)
+        return NULL;
     
     PyObject *module = PyModule_Create(&moduledef);
     PyObject *version = PyUnicode_FromString(QUOTE(VERSION));
@@ -2475,7 +6143,9 @@ aggdraw_init(void)
     Py_DECREF(version);
 #else
     DrawType.ob_type = PathType.ob_type = &PyType_Type;
+    PathGroupType.ob_type = CoverageType.ob_type = &PyType_Type;
     PenType.ob_type = BrushType.ob_type = FontType.ob_type = &PyType_Type;
+    RasterFontType.ob_type = &PyType_Type;
 
     PyObject *module = Py_InitModule3("aggdraw", aggdraw_functions, mod_doc);
     PyObject *version = PyBytes_FromString(QUOTE(VERSION));
@@ -2486,22 +6156,8 @@ aggdraw_init(void)
     if (module == NULL)
         return NULL;
 
-    PyObject* g = PyDict_New();
-    PyDict_SetItemString(g, "__builtins__", PyEval_GetBuiltins());
-    PyRun_String(
-        "try:\n"
-        "    from PIL import ImageColor\n"
-        "except ImportError:\n"
-        "    ImageColor = None\n"
-
-        "def getcolor(v):\n" // FIXME: add caching (?)
-        "    return ImageColor.getrgb(v)\n"
-
-        "", Py_file_input, g, NULL
-
-        );
-
-    aggdraw_getcolor_obj = PyDict_GetItemString(g, "getcolor");
+    /* PIL is imported the first time a color string cannot be resolved
+       natively (see getcolor_fallback) */
 
 #ifdef Py_GIL_DISABLED
     PyUnstable_Module_SetGIL(module, Py_MOD_GIL_NOT_USED);
@@ -45,15 +45,49 @@ class Font():
     
     Args:
         color: The font color.
-        file: Path to a valid TrueType font file.
+        file: Path to a valid TrueType font file, or the contents of one as
+            a bytes-like object. Buffers are used without copying, and all
+            fonts created from the same data share one font face.
         size (optional): The font size (in pixels). Defaults to 12.
         opacity (int, optional): The opacity of the font (from 0 to 255). Defaults
             to solid.
+        sdf (bool, optional): Render the text from a signed distance field
+            atlas instead of per-size glyph bitmaps. The atlas is built once
+            per font file and reused for every size and rotation, at the
+            cost of slightly softer glyph shapes. Defaults to False.
 
     """
-    def __init__(self, color, file, size=12, opacity=255):
+    def __init__(self, color, file, size=12, opacity=255, sdf=False):
         # NOTE: Only available if compiled with FreeType support
-        self._font = _aggdraw.Font(color, file, size, opacity)
+        self._font = _aggdraw.Font(color, file, size, opacity, sdf)
+
+
+class RasterFont():
+    """Creates a raster font object.
+
+    This creates a font object for use with :meth:`aggdraw.Draw.text` and
+    :meth:`aggdraw.Draw.textsize` from one of the bitmap fonts built into
+    aggdraw. Raster fonts are available without FreeType and are very
+    cheap to draw, which makes them a good fit for small annotations.
+    Glyphs are not anti-aliased, and drawing transforms only move the
+    text.
+
+    Available fonts are ``gse4x6``, ``gse4x8``, ``gse5x7``, ``gse5x9``,
+    ``gse6x9``, ``gse6x12``, ``gse7x11``, ``gse7x15``, ``gse8x16``,
+    ``mcs11_prop``, ``mcs11_prop_condensed``, ``mcs12_prop``,
+    ``mcs13_prop``, ``mcs5x10_mono``, ``mcs5x11_mono``, ``mcs6x10_mono``,
+    ``mcs6x11_mono``, ``mcs7x12_mono_high``, ``mcs7x12_mono_low`` and
+    ``verdana12`` to ``verdana18``. Most have a ``_bold`` variant.
+
+    Args:
+        color: The font color.
+        name (str, optional): The name of the font. Defaults to ``gse7x11``.
+        opacity (int, optional): The opacity of the font (from 0 to 255).
+            Defaults to solid.
+
+    """
+    def __init__(self, color, name="gse7x11", opacity=255):
+        self._font = _aggdraw.RasterFont(color, name, opacity)
 
 
 class Symbol():
@@ -71,6 +105,7 @@ class Symbol():
      * S (smooth cubic bezier)
      * Q (quadratic bezier)
      * T (smooth quadratic bezier)
+     * A (elliptical arc)
      * Z (close path)
 
     Use lower-case operators for relative coordinates, upper-case for absolute
@@ -84,6 +119,16 @@ class Symbol():
         # NOTE: 'scale' param is undocumented
         self._path = _aggdraw.Symbol(path, scale)
 
+    def __reduce__(self):
+        return _from_bytes, (Symbol, self._path.tobytes())
+
+
+def _from_bytes(cls, data):
+    # used for unpickling paths and symbols
+    obj = cls.__new__(cls)
+    obj._path = _aggdraw.path_frombytes(data)
+    return obj
+
 
 class Path():
     """Path factory.
@@ -99,25 +144,117 @@ class Path():
         else:
             self._path = _aggdraw.Path()
 
+    def __reduce__(self):
+        return _from_bytes, (Path, self._path.tobytes())
+
+    @classmethod
+    def frombytes(cls, data):
+        """Creates a path from data returned by :meth:`tobytes`.
+
+        Args:
+            data (bytes): A bytes-like object.
+
+        Returns:
+            A new path. Single precision data gives a compact path.
+
+        """
+        return _from_bytes(cls, data)
+
+    def append(self, path):
+        """Adds the subpaths of another path to this path.
+
+        The vertices are copied natively, so later changes to the other
+        path do not affect this one. Use :class:`PathGroup` to combine
+        paths without copying them.
+
+        Args:
+            path: A :class:`Path`, :class:`Symbol` or :class:`PathGroup`.
+
+        """
+        self._path.append(path._path)
+
+    def bbox(self):
+        """Returns the bounding box of the path.
+
+        The box includes curve control points, so it may be larger than
+        the curves themselves. It is cached until the path is modified,
+        which makes it cheap enough for spatial indexing.
+
+        Returns:
+            An (x0, y0, x1, y1) tuple, or None if the path is empty.
+
+        """
+        return self._path.bbox()
+
+    def clear(self):
+        """Removes all subpaths from the path.
+
+        The path keeps its memory, so a path that is cleared and rebuilt
+        for every frame stops allocating once it has reached its largest
+        size.
+
+        """
+        self._path.clear()
+
     def close(self):
         """Closes the current path."""
         self._path.close()
 
-    def coords(self):
+    def compact(self):
+        """Converts the path to compact storage.
+
+        Compact paths store their vertices in single precision, which takes
+        about half the memory of a regular path. This is meant for large
+        paths that are built once and drawn many times. A compact path is
+        drawn like any other path, and is converted back to double
+        precision if it is modified.
+
+        """
+        self._path.compact()
+
+    def coords(self, array=False, commands=False, tolerance=1.0):
         """Returns the coordinates for the path.
 
         Curves are flattened before being returned.
 
+        Args:
+            array (bool, optional): Return the coordinates as a packed
+                float64 array of shape (N, 2) instead of a list. The array
+                supports the buffer protocol, so it can be wrapped with
+                ``memoryview`` or ``numpy.asarray`` without copying.
+            commands (bool, optional): Also return the vertex commands,
+                which allow subpaths to be recovered. Each command is 1 for
+                the first vertex of a subpath and 2 otherwise, with 0x40
+                added on the last vertex of a closed subpath. Commands are
+                a uint8 array of shape (N,) if ``array`` is set.
+            tolerance (float, optional): Curve flattening tolerance
+                relative to the default, in path units. Use the inverse of
+                the display scale to get one vertex count per screen size.
+
         Returns:
-            list: A sequence in (x, y, x, y, ...) format.
+            A sequence in (x, y, x, y, ...) format, or an (N, 2) array. If
+            ``commands`` is set, a (coords, commands) tuple.
 
         """
-        return self._path.coords()
+        return self._path.coords(array, commands, tolerance)
 
     def curveto(self, x1, y1, x2, y2, x, y):
         """Adds a bezier curve segment to the path."""
         self._path.curveto(x1, y1, x2, y2, x, y)
 
+    def extend(self, paths):
+        """Adds the subpaths of several paths to this path.
+
+        All paths are added in one native call, and none is added if one
+        of them has the wrong type.
+
+        Args:
+            paths: An iterable of :class:`Path`, :class:`Symbol` or
+                :class:`PathGroup` objects.
+
+        """
+        self._path.extend([path._path for path in paths])
+
     def lineto(self, x, y):
         """Adds a line segment to the path."""
         self._path.lineto(x, y)
@@ -148,6 +285,129 @@ class Path():
         """Moves the path pointer relative to the current position."""
         self._path.rmoveto(x, y)
 
+    def tobytes(self, float32=False):
+        """Serializes the path to a compact binary string.
+
+        The data holds the vertex commands and the packed coordinates in
+        native byte order, so loading it is little more than a copy. Paths
+        can also be pickled, which uses the same format.
+
+        Args:
+            float32 (bool, optional): Store coordinates in single precision.
+                Compact paths are always stored in single precision.
+
+        Returns:
+            A bytes object for use with :meth:`frombytes`.
+
+        """
+        return self._path.tobytes(float32)
+
+    def transform(self, transform):
+        """Transforms the path in place.
+
+        All vertices, including curve control points, are updated in a
+        single native pass, so a cached path can follow a panned or
+        zoomed viewport without being rebuilt.
+
+        Example::
+           path.transform((dx, dy))
+           path.transform(lambda xy: project(xy))
+
+        Args:
+            transform: A (dx, dy) translation tuple, a PIL-style
+                (a, b, c, d, e, f) affine transform tuple, or a function.
+                The function is called with a writable float64 array of
+                shape (N, 2) holding all vertices. It can update the array
+                in place and return None, or return a new buffer of the
+                same shape and type.
+
+        """
+        self._path.transform(transform)
+
+
+class PathGroup():
+    """Path group factory.
+
+    This creates a group of paths that is drawn as a single path, for use
+    with :meth:`aggdraw.Draw.path`, :meth:`aggdraw.Draw.line` and
+    :meth:`aggdraw.Draw.polygon`. The group refers to the paths instead of
+    copying them, so shared pieces can be combined into several overlays
+    without using more memory, and changes to a path show up the next time
+    a group that contains it is drawn.
+
+    Args:
+        paths: An iterable of :class:`Path`, :class:`Symbol` or
+            :class:`PathGroup` objects. Nested groups are merged into the
+            new group.
+
+    """
+    def __init__(self, paths):
+        self._path = _aggdraw.PathGroup([path._path for path in paths])
+
+    def bbox(self):
+        """Returns the bounding box of all paths in the group.
+
+        Returns:
+            An (x0, y0, x1, y1) tuple, or None if all paths are empty.
+
+        """
+        return self._path.bbox()
+
+
+class Coverage():
+    """Rasterized shape.
+
+    Coverage objects are created by :meth:`aggdraw.Draw.coverage`, and
+    filled with :meth:`aggdraw.Draw.fill`. They hold the antialiased
+    scanlines of a shape in device pixels, so a complex shape that is
+    drawn at the same place on many frames (a country mask, a swath
+    outline) is rasterized once, and each fill costs only the blending.
+
+    """
+    def __reduce__(self):
+        return Coverage.frombytes, (self._coverage.tobytes(),)
+
+    @classmethod
+    def frombytes(cls, data):
+        """Creates a coverage from data returned by :meth:`tobytes`.
+
+        Args:
+            data (bytes): A bytes-like object.
+
+        Returns:
+            A new coverage.
+
+        """
+        obj = cls.__new__(cls)
+        obj._coverage = _aggdraw.coverage_frombytes(data)
+        return obj
+
+    def bbox(self):
+        """Returns the bounding box of the coverage.
+
+        Returns:
+            An (x0, y0, x1, y1) tuple in device pixels, with the lower right
+            corner not included, or None if the coverage is empty.
+
+        """
+        return self._coverage.bbox()
+
+    @property
+    def nbytes(self):
+        """int: The memory used by the stored scanlines, in bytes."""
+        return self._coverage.nbytes()
+
+    def tobytes(self):
+        """Serializes the coverage to a binary string.
+
+        The data uses the native byte order.
+
+        Returns:
+            bytes: Data that can be passed to :meth:`frombytes`.
+
+        """
+        return self._coverage.tobytes()
+
 
 class Draw():
     """Creates a drawing interface object.
@@ -192,6 +452,25 @@ class Draw():
             pen = pen._brush if isinstance(pen, Brush) else pen._pen
         return (brush, pen)
 
+    def _parse_shapes(self, shapes):
+        return [s._path if isinstance(s, (Path, PathGroup)) else s
+                for s in shapes]
+
+    def addclip(self, box):
+        """Adds a rectangle to the clip region.
+
+        Drawing covers the union of the rectangles given to
+        :meth:`setclip` and :meth:`addclip`. Each shape is still
+        rasterized once, so an overlay shared by several panels of a
+        figure is drawn into all of them in a single pass.
+
+        Args:
+            box: A 4-element tuple (x0, y0, x1, y1), as for
+                :meth:`setclip`.
+
+        """
+        self._draw.addclip(box)
+
     def arc(self, xy, start, end, pen=None):
         """Draws an arc.
 
@@ -229,6 +508,30 @@ class Draw():
         brush, pen = self._parse_args(brush, pen)
         self._draw.chord(xy, start, end, pen, brush)
 
+    def coverage(self, shapes, op="union"):
+        """Rasterizes shapes once, for filling them many times.
+
+        The shapes are combined as for :meth:`polygon_union` and the
+        other boolean operations, using the current transform, clip region
+        and antialiasing setting.
+
+        Args:
+            shapes: A :class:`Path` or :class:`PathGroup`, or a Python
+                sequence of paths, groups or polygon coordinate sequences.
+            op (str, optional): How to combine the shapes: "union",
+                "intersection", "xor" or "difference".
+
+        Returns:
+            :class:`Coverage`: A coverage object, for use with :meth:`fill`.
+
+        """
+        if isinstance(shapes, (Path, PathGroup)):
+            shapes = [shapes]
+        coverage = Coverage.__new__(Coverage)
+        coverage._coverage = self._draw.coverage(self._parse_shapes(shapes),
+                                                 op)
+        return coverage
+
     def ellipse(self, xy, pen=None, brush=None):
         """Draws an ellipse.
         
@@ -250,6 +553,21 @@ class Draw():
         brush, pen = self._parse_args(brush, pen)
         self._draw.ellipse(xy, brush, pen)
 
+    def fill(self, coverage, brush, offset=(0, 0)):
+        """Fills a coverage object created by :meth:`coverage`.
+
+        No geometry is processed; the stored scanlines are blended
+        directly, through the current clip region and mask.
+
+        Args:
+            coverage (:obj:`aggdraw.Coverage`): The shape to fill.
+            brush (:obj:`aggdraw.Brush`): A brush to use for filling.
+            offset (tuple, optional): A (dx, dy) offset in device pixels,
+                rounded to whole pixels.
+
+        """
+        self._draw.fill(coverage._coverage, brush._brush, offset)
+
     def flush(self):
         """Updates the associated image.
         
@@ -279,7 +597,7 @@ class Draw():
             pen (:obj:`aggdraw.Pen`, optional): A pen to use for drawing the line.
 
         """
-        if isinstance(xy, Path):
+        if isinstance(xy, (Path, PathGroup)):
             xy = xy._path
         if pen:
             pen = pen._pen
@@ -294,7 +612,8 @@ class Draw():
 
         Args:
             xy: A Python sequence in the format (x, y, x, y, ...)
-            path (:obj:`aggdraw.Path`): The Path object to draw.
+            path (:obj:`aggdraw.Path` or :obj:`aggdraw.PathGroup`): The path,
+                or group of paths, to draw.
             pen (:obj:`aggdraw.Pen`, optional): A pen to use for drawing an outline
                 around the path.
             brush (:obj:`aggdraw.Brush`, optional): A brush to use for filling
@@ -302,7 +621,7 @@ class Draw():
         
         """
         brush, pen = self._parse_args(brush, pen)
-        self._draw.path(xy, path._path, brush, pen)
+        self._draw.symbol(xy, path._path, brush, pen)
 
     def pieslice(self, xy, start, end, pen=None, brush=None):
         """Draws a pie slice.
@@ -340,11 +659,75 @@ class Draw():
                 the polygon.
         
         """
-        if isinstance(xy, Path):
+        if isinstance(xy, (Path, PathGroup)):
             xy = xy._path
         brush, pen = self._parse_args(brush, pen)
         self._draw.polygon(xy, brush, pen)
 
+    def polygon_difference(self, shapes, brush):
+        """Fills the first shape, minus all the others.
+
+        See :meth:`polygon_union` for how shapes are combined.
+
+        Args:
+            shapes: A Python sequence of :class:`Path` or :class:`PathGroup`
+                objects, or of polygon coordinate sequences (x, y, x, y, ...).
+            brush (:obj:`aggdraw.Brush`): A brush to use for filling the
+                result.
+
+        """
+        self._draw.combine("difference", self._parse_shapes(shapes),
+                           brush._brush)
+
+    def polygon_intersection(self, shapes, brush):
+        """Fills the area covered by all of the shapes.
+
+        See :meth:`polygon_union` for how shapes are combined.
+
+        Args:
+            shapes: A Python sequence of :class:`Path` or :class:`PathGroup`
+                objects, or of polygon coordinate sequences (x, y, x, y, ...).
+            brush (:obj:`aggdraw.Brush`): A brush to use for filling the
+                result.
+
+        """
+        self._draw.combine("intersection", self._parse_shapes(shapes),
+                           brush._brush)
+
+    def polygon_union(self, shapes, brush):
+        """Fills the area covered by any of the shapes.
+
+        The shapes are rasterized and combined as pixel coverage, with no
+        vector geometry involved, and the result is filled once. Where
+        translucent shapes overlap, they are blended once rather than
+        once per shape, and thousands of overlapping buffers or range
+        rings cost little more than drawing them one by one.
+
+        Args:
+            shapes: A Python sequence of :class:`Path` or :class:`PathGroup`
+                objects, or of polygon coordinate sequences (x, y, x, y, ...).
+            brush (:obj:`aggdraw.Brush`): A brush to use for filling the
+                result.
+
+        """
+        self._draw.combine("union", self._parse_shapes(shapes),
+                           brush._brush)
+
+    def polygon_xor(self, shapes, brush):
+        """Fills the area covered by an odd number of the shapes.
+
+        See :meth:`polygon_union` for how shapes are combined.
+
+        Args:
+            shapes: A Python sequence of :class:`Path` or :class:`PathGroup`
+                objects, or of polygon coordinate sequences (x, y, x, y, ...).
+            brush (:obj:`aggdraw.Brush`): A brush to use for filling the
+                result.
+
+        """
+        self._draw.combine("xor", self._parse_shapes(shapes),
+                           brush._brush)
+
     def rectangle(self, xy, pen=None, brush=None):
         """Draws a rectangle.
         
@@ -364,6 +747,11 @@ class Draw():
         brush, pen = self._parse_args(brush, pen)
         self._draw.rectangle(xy, brush, pen)
 
+    def resetclip(self):
+        """Removes the clip region set by :meth:`setclip` and
+        :meth:`addclip`."""
+        self._draw.resetclip()
+
     def rounded_rectangle(self, xy, radius, pen=None, brush=None):
         """Draws a rounded rectangle.
         
@@ -393,6 +781,46 @@ class Draw():
         """
         self._draw.setantialias(flag)
 
+    def setclip(self, box):
+        """Limits drawing to a rectangle.
+
+        Pixels outside the rectangle are left alone, and shapes that fall
+        entirely outside of it are skipped before any path is built, so
+        drawing an inset or a legend into part of the canvas only costs
+        what lands in that part.
+
+        Args:
+            box: A 4-element tuple (x0, y0, x1, y1) in device pixels, with
+                the upper left corner given first. The lower right corner
+                is not included, as for PIL's crop method.
+
+        """
+        self._draw.setclip(box)
+
+    def setmask(self, mask=None):
+        """Limits drawing to the inside of a shape, or to an alpha mask.
+
+        Unlike :meth:`setclip`, the mask need not be rectangular, and its
+        edges are antialiased. The mask is rasterized once and kept until
+        the next call, so a whole plot can be drawn through a rounded or
+        circular viewport at little extra cost.
+
+        Args:
+            mask: A :class:`Path`, :class:`PathGroup` or :class:`Symbol` to
+                fill, in user coordinates; a mode "L" PIL image of the same
+                size as the canvas; or a bytes-like object with one byte per
+                pixel, where 0 hides the pixel and 255 leaves it alone. If
+                omitted or None, the mask is removed.
+
+        """
+        if isinstance(mask, (Path, PathGroup, Symbol)):
+            mask = mask._path
+        elif hasattr(mask, "mode"):
+            if mask.mode != "L":
+                raise ValueError("mask image must have mode 'L'")
+            mask = mask.tobytes()
+        self._draw.setmask(mask)
+
     def settransform(self, transform=None):
         """Replaces the current drawing transform.
 
@@ -412,6 +840,35 @@ class Draw():
         else:
             self._draw.settransform()
 
+    def setsimplify(self, tolerance=0):
+        """Sets the simplification tolerance.
+
+        Vertices closer than the tolerance to the previous one are dropped
+        after the transform is applied, so that dense polylines cost no
+        more than the pixels they cover.
+
+        Args:
+            tolerance (float, optional): Tolerance in device pixels. A
+                quarter of a pixel or less is not visible. 0 turns
+                simplification off.
+
+        """
+        self._draw.setsimplify(tolerance)
+
+    def settolerance(self, tolerance=1.0):
+        """Sets the curve flattening tolerance.
+
+        Curves, arcs, ellipses and outline text are flattened with a number
+        of vertices that follows their size after the current transform.
+        The tolerance scales that error bound.
+
+        Args:
+            tolerance (float, optional): Tolerance relative to the default.
+                Larger values produce fewer vertices and coarser curves.
+
+        """
+        self._draw.settolerance(tolerance)
+
     def symbol(self, xy, symbol, pen=None, brush=None):
         """Draws a symbol at the given positions.
         
@@ -441,7 +898,8 @@ class Draw():
         Args:
             xy: A 2-element Python sequence (x, y).
             text (str): A string of text to render.
-            font (:obj:`aggdraw.Font`): The font object to render with.
+            font (:obj:`aggdraw.Font` or :obj:`aggdraw.RasterFont`): The
+                font object to render with.
 
         Returns:
             tuple: A (width, height) tuple.
@@ -454,7 +912,8 @@ class Draw():
 
         Args:
             text (str): A string of text to measure.
-            font (:obj:`aggdraw.Font`): The font object to render with.
+            font (:obj:`aggdraw.Font` or :obj:`aggdraw.RasterFont`): The
+                font object to render with.
 
         Returns:
             tuple: A (width, height) tuple.
@@ -470,3 +929,36 @@ class Draw():
         
         """
         return self._draw.tobytes()
+
+
+def save_glyph_cache(filename):
+    """Writes the current glyph cache to a file.
+
+    The file can be loaded by :func:`aggdraw.load_glyph_cache` in a later
+    process (or in several processes at once) to skip rasterizing glyphs
+    that have already been drawn. Cache files are only valid for the
+    aggdraw build that wrote them.
+
+    Args:
+        filename (str): Path of the cache file to write.
+
+    """
+    # NOTE: Only available if compiled with FreeType support
+    _aggdraw.save_glyph_cache(filename)
+
+
+def load_glyph_cache(filename):
+    """Loads a glyph cache file written by :func:`aggdraw.save_glyph_cache`.
+
+    The file is memory-mapped read-only, so processes loading the same
+    file share its pages. Fonts that already have cached glyphs in this
+    process are left untouched.
+
+    Args:
+        filename (str): Path of the cache file to load.
+
+    Raises:
+        ValueError: If the file is not a valid cache for this build.
+
+    """
+    _aggdraw.load_glyph_cache(filename)
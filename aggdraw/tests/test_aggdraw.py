@@ -62,6 +62,32 @@ def test_brush():
     Brush("gold")
 
 
+def test_color_strings():
+    from aggdraw import Draw, Brush
+
+    def fill(color):
+        draw = Draw("RGBA", (2, 2), (0, 0, 0, 0))
+        draw.rectangle((-1, -1, 3, 3), Brush(color))
+        return draw.tobytes()[:4]
+
+    expected = {
+        "lightgoldenrodyellow": (250, 250, 210),
+        "RebeccaPurple": (102, 51, 153),
+        "#abc": (170, 187, 204),
+        "#abcd": (170, 187, 204, 221),
+        "#A1B2C3": (161, 178, 195),
+        "#a1b2c3d4": (161, 178, 195, 212),
+        "rgb( 10% , 20%, 30% )": (26, 51, 77),
+        "rgba(1, 2, 3, 4)": (1, 2, 3, 4),
+        "hsl(200.5, 30%, 40%)": (71, 112, 133),
+        "hsv(120, 50%, 50%)": (64, 128, 64),
+    }
+    for color, rgb in expected.items():
+        assert fill(color) == fill(rgb), color
+        assert fill(color) == fill(color)  # cached
+    assert fill("no such color") == fill((0, 0, 0))
+
+
 def test_graphics():
     from aggdraw import Draw, Pen, Brush
     draw = Draw("RGB", (500, 500))
@@ -132,6 +158,267 @@ def test_path():
     draw.symbol((0, 0), p)
 
 
+def test_path_curves():
+    from aggdraw import Draw, Path, Pen, Brush
+    p = Path()
+    p.moveto(10, 50)
+    for i in range(20):
+        p.curveto(10 + i * 8, 10, 14 + i * 8, 90, 18 + i * 8, 50)
+    p.rcurveto(10, -30, 20, 30, 30, 0)
+    p.lineto(200, 90)
+    p.close()
+    # curves are flattened at draw time, as they are by coords()
+    flat = Path(p.coords())
+    flat.close()
+
+    def render(path):
+        draw = Draw("L", (220, 100), "white")
+        draw.polygon(path, Pen("black", 2), Brush("gray"))
+        return draw.tobytes()
+
+    assert render(p) == render(flat)
+
+
+def test_path_coords_array():
+    from aggdraw import Path
+    p = Path()
+    p.moveto(0, 0)
+    p.lineto(1, 1)
+    p.lineto(2, 0)
+    p.close()
+    p.moveto(5, 5)
+    p.lineto(6, 5)
+
+    coords, commands = p.coords(array=True, commands=True)
+    view = memoryview(coords)
+    assert view.format == "d" and view.shape == (5, 2)
+    assert view.tolist() == [[0, 0], [1, 1], [2, 0], [5, 5], [6, 5]]
+    assert list(bytes(commands)) == [1, 2, 2 | 0x40, 1, 2]
+    assert p.coords(commands=True) == (p.coords(), [1, 2, 0x42, 1, 2])
+    assert memoryview(Path().coords(array=True)).shape == (0, 2)
+
+
+def test_path_compact():
+    from aggdraw import Draw, Path, Pen, Brush
+    p = Path()
+    p.moveto(10.5, 10.25)
+    p.curveto(40, 0, 60, 90, 90, 50)
+    p.lineto(30, 80)
+    p.close()
+    p.moveto(5, 90)
+    p.lineto(95, 95)
+
+    def render(path):
+        draw = Draw("L", (100, 100), "white")
+        draw.polygon(path, Pen("black", 2), Brush("gray"))
+        draw.line(path, Pen("black"))
+        draw.symbol((1, 2), path, Pen("black"))
+        return draw.tobytes()
+
+    expected = render(p)
+    coords = p.coords(commands=True)
+    p.compact()
+    assert p.coords(commands=True) == coords
+    assert render(p) == expected
+    # editing a compact path converts it back
+    p.lineto(0, 0)
+    assert p.coords()[-2:] == [0.0, 0.0]
+
+
+def test_path_bbox():
+    from aggdraw import Draw, Path, Pen, Symbol
+    p = Path()
+    assert p.bbox() is None
+    p.moveto(10, 20)
+    p.lineto(30, 5)
+    assert p.bbox() == (10, 5, 30, 20)
+    p.curveto(40, 0, 50, 60, 35, 25)
+    assert p.bbox() == (10, 0, 50, 60)
+    p.compact()
+    assert p.bbox() == (10, 0, 50, 60)
+    p.rlineto(-40, 0)
+    assert p.bbox() == (-5, 0, 50, 60)
+
+    # culled paths and symbols leave the canvas alone, visible ones don't
+    draw = Draw("L", (20, 20), "white")
+    draw.line(p, Pen("black"))
+    visible = draw.tobytes()
+    draw = Draw("L", (20, 20), "white")
+    draw.settransform((100, 100))
+    draw.line(p, Pen("black"))
+    draw.symbol((0, 0, -200, -200), Symbol("M0,0L10,10"), Pen("black"))
+    assert draw.tobytes() == b"\xff" * 400 != visible
+
+
+def test_path_transform():
+    from aggdraw import Path
+    import numpy as np
+    p = Path()
+    p.moveto(0, 0)
+    p.curveto(1, 2, 3, 4, 5, 6)
+    p.close()
+    p.transform((10, 20))
+    assert p.bbox() == (10, 20, 15, 26)
+    p.transform((2, 0, 0, 0, 1, 0))
+    assert p.bbox() == (20, 20, 30, 26)
+    p.compact()
+    p.transform((-20, -20))
+    assert p.bbox() == (0, 0, 10, 6)
+
+    def halve(xy):
+        xy = np.asarray(xy)
+        assert xy.shape == (4, 2)
+        xy /= 2
+
+    p.transform(halve)
+    assert p.bbox() == (0, 0, 5, 3)
+    p.transform(lambda xy: np.asarray(xy) + 1)
+    assert p.bbox() == (1, 1, 6, 4)
+    with pytest.raises(ValueError):
+        p.transform(lambda xy: np.zeros((3, 2)))
+    with pytest.raises(ZeroDivisionError):
+        p.transform(lambda xy: 1 / 0)
+    assert p.bbox() == (1, 1, 6, 4)
+
+    def grow(xy):
+        p.lineto(100, 100)
+
+    with pytest.raises(RuntimeError):
+        p.transform(grow)
+
+
+def test_path_append():
+    from aggdraw import Draw, Brush, Path, PathGroup, Symbol
+    a = Path([0, 0, 40, 0, 40, 40])
+    a.close()
+    b = Path([60, 60, 90, 60, 90, 90])
+    b.close()
+    c = Symbol("M10,60h20v20h-20z")
+
+    p = Path()
+    p.extend([a, b, c])
+    assert p.bbox() == (0, 0, 90, 90)
+    assert p.coords() == a.coords() + b.coords() + c._path.coords()
+
+    # appending a path to itself copies it once
+    q = Path([0, 0, 10, 10])
+    q.compact()
+    q.append(q)
+    assert q.coords() == [0, 0, 10, 10, 0, 0, 10, 10]
+
+    group = PathGroup([PathGroup([a, b]), c])
+    assert group.bbox() == (0, 0, 90, 90)
+    q = Path()
+    q.append(group)
+    assert q.coords() == p.coords()
+
+    # a group is drawn like the merged path
+    brush = Brush("black")
+    d1 = Draw("L", (100, 100), "white")
+    d1.path((0, 0), p, None, brush)
+    d2 = Draw("L", (100, 100), "white")
+    d2.path((0, 0), group, None, brush)
+    assert d1.tobytes() == d2.tobytes()
+    d2 = Draw("L", (100, 100), "white")
+    d2.polygon(group, None, brush)
+    assert d1.tobytes() == d2.tobytes()
+    d1.path((5, 5), p, None, brush)
+    d2.symbol((5, 5), group, None, brush)
+    assert d1.tobytes() == d2.tobytes()
+
+    # and follows changes to its paths
+    b.moveto(0, 90)
+    b.lineto(10, 100)
+    assert group.bbox() == (0, 0, 90, 100)
+    assert PathGroup([]).bbox() is None
+
+    with pytest.raises(TypeError):
+        p._path.append(1)
+    before = p.coords()
+    with pytest.raises(TypeError):
+        p._path.extend([a._path, 1])
+    assert p.coords() == before
+    p.extend([p, p])
+    assert p.coords() == before * 4
+
+
+def test_path_clear():
+    from aggdraw import Draw, Brush, Path, Pen
+    p = Path([0, 0, 10, 10])
+    p.clear()
+    assert p.bbox() is None and p.coords() == []
+    p.moveto(1, 2)
+    p.lineto(3, 4)
+    assert p.coords() == [1, 2, 3, 4]
+    p.compact()
+    p.clear()
+    assert p.bbox() is None and p.coords() == []
+
+    # shapes share a scratch path and point buffer, which must be reset
+    # between calls
+    big = [v for i in range(1000) for v in (50 + 40 * (i % 2), 50 + i % 7)]
+    small = (5, 5, 20, 5, 20, 20)
+    d1 = Draw("L", (100, 100), "white")
+    d1.polygon(big, Pen("black"), Brush("gray"))
+    d1.polygon(small, Brush("black"))
+    d1.rectangle((30, 0, 40, 10), Brush("black"))
+    d1.symbol((0, 30, 0, 60), Path([0, 0, 10, 10]), Pen("black"))
+    d2 = Draw("L", (100, 100), "white")
+    p = Path(big)
+    p.close()
+    d2.polygon(p, Pen("black"), Brush("gray"))
+    d2.polygon(Path(small), Brush("black"))
+    d2.polygon(Path([30, 0, 40, 0, 40, 10, 30, 10]), Brush("black"))
+    d2.line(Path([0, 30, 10, 40]), Pen("black"))
+    d2.line(Path([0, 60, 10, 70]), Pen("black"))
+    assert d1.tobytes() == d2.tobytes()
+
+    # converting a coordinate can draw on the same object, which must not
+    # disturb the point buffer being filled
+    class Reentrant(object):
+        def __init__(self, value):
+            self.value = value
+
+        def __float__(self):
+            d1.line([float(i % 100) for i in range(4000)], Pen("black"))
+            return self.value
+
+    d1.polygon([Reentrant(v) for v in small], Brush("black"))
+    d1.polygon_union([[Reentrant(v) for v in small]], Brush("black"))
+
+
+def test_path_bytes():
+    from aggdraw import Path, Symbol
+    import pickle
+    p = Path()
+    p.moveto(0.1, 0.2)
+    p.curveto(1, 2, 3, 4, 5, 6)
+    p.close()
+    p.moveto(7, 8)
+    p.lineto(9, 10)
+    coords = p.coords(commands=True)
+
+    data = p.tobytes()
+    assert Path.frombytes(data).coords(commands=True) == coords
+    assert Path.frombytes(memoryview(b"x" + data)[1:]).tobytes() == data
+    assert len(p.tobytes(float32=True)) < len(data)
+    q = pickle.loads(pickle.dumps(p))
+    assert isinstance(q, Path) and q.coords(commands=True) == coords
+
+    p.compact()
+    q = Path.frombytes(p.tobytes())
+    assert q.tobytes() == p.tobytes(float32=True)
+    assert q.coords(commands=True) == p.coords(commands=True)
+
+    s = pickle.loads(pickle.dumps(Symbol("M0,0A5,5 0 0,1 10,0Z")))
+    assert isinstance(s, Symbol)
+    assert s._path.coords() == Symbol("M0,0A5,5 0 0,1 10,0Z")._path.coords()
+
+    for bad in (b"", data[:-1], b"XXXX" + data[4:]):
+        with pytest.raises(ValueError):
+            Path.frombytes(bad)
+
+
 def test_symbol():
     from aggdraw import Symbol
     Symbol("M0,0L0,0L0,0L0,0Z")
@@ -145,6 +432,34 @@ def test_symbol():
     Symbol("m0,0s0,0,0,0,0,0z")
 
 
+def test_symbol_grammar():
+    from aggdraw import Symbol
+
+    def coords(path):
+        return Symbol(path)._path.coords()
+
+    # packed numbers, exponents and implicit commands
+    assert coords("M1e1-5.5.5.5") == [10, -5.5, 0.5, 0.5]
+    assert coords("m1 2 3 4 h5 v-1 H0 V0 z") == [1, 2, 4, 6, 9, 6, 9, 5,
+                                                  0, 5, 0, 0]
+    # drawing after a close starts from the beginning of the subpath
+    assert coords("M0,0L10,0L10,10ZL0,10") == [0, 0, 10, 0, 10, 10,
+                                               0, 0, 0, 10]
+    # smooth curves reflect the previous control point
+    assert (coords("M0,0C0,10 10,10 10,0S20,-10 20,0") ==
+            coords("M0,0C0,10 10,10 10,0C10,-10 20,-10 20,0"))
+    assert (coords("M0,0Q5,10 10,0T20,0") ==
+            coords("M0,0Q5,10 10,0Q15,-10 20,0"))
+
+    arc = coords("M0,0A10,10 0 0,1 20,0")
+    assert min(arc[1::2]) == pytest.approx(-10) and arc[-2:] == [20, 0]
+    assert coords("M0,0a10,10 0 0120,0") == arc
+
+    for path in ("M0,0X1", "10,10", "M", "M0,0Z1"):
+        with pytest.raises(ValueError):
+            Symbol(path)
+
+
 def test_transform():
     from aggdraw import Draw
     draw = Draw("RGB", (500, 500))
@@ -154,3 +469,462 @@ def test_transform():
     draw.settransform((1, 0, 250, 0, 1, 250))
     draw.settransform((2.0, 0.5, 250, 0.5, 2.0, 250))
     draw.settransform()
+
+
+def test_tolerance():
+    from aggdraw import Draw, Brush, Path
+    import numpy as np
+
+    def render(scale):
+        draw = Draw("L", (120, 120), "black")
+        draw.settransform((scale, 0, 0, 0, scale, 0))
+        draw.ellipse((10 / scale, 10 / scale, 110 / scale, 110 / scale),
+                     Brush("white"))
+        return np.frombuffer(draw.tobytes(), dtype=np.uint8).astype(int)
+
+    # tessellation follows the on-screen size, not the user space size
+    assert np.abs(render(10.0) - render(1.0)).max() < 16
+
+    draw = Draw("L", (10, 10))
+    draw.settolerance(4.0)
+    draw.settolerance()
+    with pytest.raises(ValueError):
+        draw.settolerance(0)
+
+    p = Path()
+    p.moveto(0, 0)
+    p.curveto(0, 100, 100, 100, 100, 0)
+    counts = [len(p.coords(tolerance=t)) for t in (0.1, 1.0, 10.0)]
+    assert counts[0] > counts[1] > counts[2]
+
+
+def test_viewport_clip():
+    from aggdraw import Draw, Pen, Brush
+    import numpy as np
+
+    def render(*coords):
+        draw = Draw("L", (100, 100), "white")
+        for xy in coords:
+            draw.polygon(xy, Pen("black", 3), Brush("gray"))
+        return np.frombuffer(draw.tobytes(), dtype=np.uint8).reshape(100, 100)
+
+    # far-away vertices must not overflow the rasterizer
+    image = render((1e9, 1e9, -1e9, -1e9))
+    assert image[50, 50] == 0 and image[10, 90] == 255
+
+    # an open contour reaching outside is still filled as if closed
+    image = render((-50, 20, 80, 20, 80, 150))
+    assert image[40, 40] < 255 and image[95, 20] == 255
+
+    # clipping leaves shapes inside the canvas alone
+    image = render((10, 10, 90, 10, 90, 90, 10, 90))
+    assert image[50, 50] < 255 and image[9, 9] == 0 and image[7, 7] == 255
+
+    # a clipped closed outline keeps the join at its first vertex
+    def outline(size):
+        draw = Draw("L", (size, size), "white")
+        draw.polygon((30, 30, 70, 40, 300, 300), Pen("black", 9))
+        image = np.frombuffer(draw.tobytes(), dtype=np.uint8)
+        return image.reshape(size, size)[:100, :100].astype(int)
+
+    image = outline(100)
+    assert image[24, 20] == 0
+    assert abs(image - outline(400)).max() <= 1
+
+
+def test_polygon_union():
+    from aggdraw import Draw, Brush, Path
+    import numpy as np
+
+    a = [10, 10, 60, 10, 60, 60, 10, 60]
+    b = Path([40, 40, 90, 40, 90, 90, 40, 90])
+    b.close()
+
+    def render(op, shapes, brush=Brush("black")):
+        draw = Draw("L", (100, 100), "white")
+        getattr(draw, "polygon_" + op)(shapes, brush)
+        return np.frombuffer(draw.tobytes(), dtype=np.uint8).reshape(100, 100)
+
+    def area(image):
+        return int((image < 128).sum())
+
+    # one shape fills as polygon does
+    draw = Draw("L", (100, 100), "white")
+    draw.polygon(a, None, Brush("black"))
+    assert render("union", [a]).tobytes() == draw.tobytes()
+
+    assert area(render("union", [a, b])) == 2 * 2500 - 400
+    assert area(render("intersection", [a, b])) == 400
+    assert area(render("xor", [a, b])) == 2 * 2500 - 2 * 400
+    assert area(render("difference", [a, b])) == 2500 - 400
+    assert area(render("difference", [a, b, [0, 0, 20, 0, 20, 20]])) < 2100
+    c = [20, 20, 80, 20, 80, 30, 20, 30]
+    assert area(render("union", [a, b, c])) == 2 * 2500 - 400 + 200
+
+    # overlapping translucent shapes blend once
+    image = render("union", [a, b], Brush("black", 128))
+    assert image[50, 50] == image[20, 20] == image[80, 80]
+
+    assert (render("union", []) == 255).all()
+    # a shape without points is empty
+    assert area(render("union", [[], a])) == 2500
+    assert area(render("intersection", [a, []])) == 0
+    draw = Draw("L", (100, 100), "white")
+    with pytest.raises(ValueError):
+        draw._draw.combine("bogus", [a], Brush("black")._brush)
+    with pytest.raises(TypeError):
+        draw.polygon_union([a, None], Brush("black"))
+
+
+def test_coverage():
+    from aggdraw import Draw, Brush, Path, Coverage
+    import pickle
+
+    shape = Path([10.5, 10, 60, 20, 40, 60.3])
+    shape.close()
+    moved = Path([20.5, 15, 70, 25, 50, 65.3])
+    moved.close()
+
+    def render(path):
+        draw = Draw("L", (100, 100), "white")
+        draw.polygon(path, None, Brush("black", 200))
+        return draw.tobytes()
+
+    draw = Draw("L", (100, 100), "white")
+    coverage = draw.coverage(shape)
+    assert coverage.bbox() == (10, 9, 61, 61)
+    assert coverage.nbytes > 0
+    draw.fill(coverage, Brush("black", 200))
+    assert draw.tobytes() == render(shape)
+
+    # replayed at a whole-pixel offset, with no geometry work
+    draw = Draw("L", (100, 100), "white")
+    draw.fill(coverage, Brush("black", 200), (10, 5))
+    assert draw.tobytes() == render(moved)
+    draw.fill(coverage, Brush("black"), (500, 500))
+
+    copy = pickle.loads(pickle.dumps(coverage))
+    assert copy.tobytes() == coverage.tobytes()
+    assert Coverage.frombytes(coverage.tobytes()).bbox() == coverage.bbox()
+
+    empty = draw.coverage([])
+    assert empty.bbox() is None and empty.nbytes == 0
+    draw.fill(empty, Brush("black"))
+
+    with pytest.raises(ValueError):
+        Coverage.frombytes(coverage.tobytes()[:-1])
+
+    # the stored format has int16 coordinates and 64 KiB scanlines
+    with pytest.raises(ValueError):
+        Draw("L", (40000, 1)).coverage([])
+    comb = [0, 4, 0, 0]
+    for x in range(1, 32000, 2):
+        comb += [x, 0, x, 2, x + 1, 2, x + 1, 0]
+    comb += [32001, 0, 32001, 4]
+    with pytest.raises(ValueError):
+        Draw("L", (32001, 4)).coverage([comb])
+    assert Draw("L", (32001, 4)).coverage([comb[:400] + [200, 4]]).nbytes
+
+
+def test_setclip():
+    from aggdraw import Draw, Pen, Brush, Path
+    import numpy as np
+
+    def render(clip, *boxes):
+        draw = Draw("L", (100, 100), "white")
+        if clip:
+            draw.setclip(clip)
+        for box in boxes:
+            draw.addclip(box)
+        draw.rectangle((0, 0, 100, 100), Brush("gray"))
+        draw.ellipse((10, 10, 90, 90), Pen("black", 5))
+        draw.line(Path([0, 0, 100, 100]), Pen("black", 3))
+        draw.symbol((0, 0), Path([100, 0, 0, 100]), Pen("black", 3))
+        return np.frombuffer(draw.tobytes(), dtype=np.uint8).reshape(100, 100)
+
+    full = render(None)
+    image = render((20, 30, 60, 70)).copy()
+    assert (image[30:70, 20:60] == full[30:70, 20:60]).all()
+    image[30:70, 20:60] = 255
+    assert (image == 255).all()
+
+    # boxes are clamped to the canvas, and an empty box hides everything
+    assert (render((-50, -50, 500, 500)) == full).all()
+    assert (render((50, 50, 50, 80)) == 255).all()
+    assert (render((200, 200, 300, 300)) == 255).all()
+
+    # several boxes are filled from one pass, and overlap is drawn once
+    image = render((20, 30, 60, 70), (50, 0, 100, 40), (0, 90, 10, 90))
+    expected = np.full((100, 100), 255, np.uint8)
+    expected[30:70, 20:60] = full[30:70, 20:60]
+    expected[0:40, 50:100] = full[0:40, 50:100]
+    assert (image == expected).all()
+
+    draw = Draw("L", (100, 100), "white")
+    draw.setclip((0, 0, 10, 10))
+    draw.resetclip()
+    draw.rectangle((0, 0, 100, 100), Brush("gray"))
+    draw.ellipse((10, 10, 90, 90), Pen("black", 5))
+    draw.line(Path([0, 0, 100, 100]), Pen("black", 3))
+    draw.symbol((0, 0), Path([100, 0, 0, 100]), Pen("black", 3))
+    assert draw.tobytes() == full.tobytes()
+
+
+def test_setmask():
+    from aggdraw import Draw, Pen, Brush, Path
+    import numpy as np
+
+    def render(mask=None, clip=None):
+        draw = Draw("L", (100, 100), "white")
+        if clip:
+            draw.setclip(clip)
+        if mask is not None:
+            draw.setmask(mask)
+        draw.rectangle((0, 0, 100, 100), Brush("gray"))
+        draw.ellipse((10, 10, 90, 90), Pen("black", 5))
+        return np.frombuffer(draw.tobytes(), dtype=np.uint8).astype(int)
+
+    # a pixel-aligned box gives the same result as setclip
+    box = Path([20, 30, 60, 30, 60, 70, 20, 70])
+    box.close()
+    assert (render(box) == render(clip=(20, 30, 60, 70))).all()
+
+    # a gray mask blends halfway
+    draw = Draw("L", (100, 100), "white")
+    draw.setmask(b"\x80" * 10000)
+    draw.rectangle((0, 0, 100, 100), Brush("black"))
+    half = np.frombuffer(draw.tobytes(), dtype=np.uint8).astype(int)
+    assert (abs(half - 127) <= 1).all()
+
+    # a mask value of 1 rounds a quarter covered edge away
+    draw = Draw("L", (100, 100), "white")
+    draw.setmask(b"\x01" * 10000)
+    draw.rectangle((1, 0, 100, 100), Brush("black"))
+    edge = np.frombuffer(draw.tobytes(), dtype=np.uint8).reshape(100, 100)
+    assert (edge[:, 0] == 255).all() and (edge[:, 1:] == 254).all()
+
+    full = render()
+
+    draw = Draw("L", (100, 100), "white")
+    draw.setmask(box)
+    draw.setmask(None)
+    draw.rectangle((0, 0, 100, 100), Brush("gray"))
+    draw.ellipse((10, 10, 90, 90), Pen("black", 5))
+    assert (np.frombuffer(draw.tobytes(), dtype=np.uint8) == full).all()
+
+    with pytest.raises(ValueError):
+        draw.setmask(b"\xff" * 100)
+
+
+def test_simplify():
+    from aggdraw import Draw, Pen, Brush
+    import math
+    import numpy as np
+    xy = []
+    for i in range(20000):
+        a = i * 2 * math.pi / 20000
+        r = 40 + 3 * math.sin(a * 50)
+        xy += [50 + r * math.cos(a), 50 + r * math.sin(a)]
+
+    def render(tolerance):
+        draw = Draw("L", (100, 100), "white")
+        draw.setsimplify(tolerance)
+        draw.polygon(xy, Pen("black"), Brush("gray"))
+        return np.frombuffer(draw.tobytes(), dtype=np.uint8).astype(int)
+
+    exact = render(0)
+    assert np.abs(render(0.25) - exact).mean() < 1
+    with pytest.raises(ValueError):
+        Draw("L", (1, 1)).setsimplify(-1)
+
+
+def _find_font():
+    import glob
+    import os
+    from aggdraw import Font
+    for pattern in ("/usr/share/fonts/**/DejaVuSans.ttf",
+                    "/usr/share/fonts/**/*.ttf",
+                    "/Library/Fonts/*.ttf",
+                    os.path.join(os.environ.get("WINDIR", ""), "Fonts", "arial.ttf")):
+        found = glob.glob(pattern, recursive=True)
+        if found:
+            break
+    else:
+        pytest.skip("no TrueType font available")
+    try:
+        Font("black", found[0])
+    except OSError:
+        pytest.skip("aggdraw was built without FreeType")
+    return found[0]
+
+
+def test_text_subpixel():
+    from aggdraw import Draw, Font
+    import numpy as np
+    font = Font("black", _find_font(), 16)
+
+    def render(x):
+        draw = Draw("L", (100, 40), "white")
+        draw.text((x, 5), "Hi", font)
+        return np.frombuffer(draw.tobytes(), dtype=np.uint8).reshape(40, 100)
+
+    whole = render(10.0)
+    # fractional positions are rendered from shifted bitmaps, not snapped
+    assert (render(10.25) != whole).any()
+    # whole-pixel moves reuse the same bitmap
+    assert (render(11.0)[:, 1:] == whole[:, :-1]).all()
+
+
+def test_text_transform():
+    from aggdraw import Draw, Font
+    import numpy as np
+    font = Font("black", _find_font(), 16)
+
+    def render(transform):
+        draw = Draw("L", (200, 200), "white")
+        if transform:
+            draw.settransform(transform)
+        draw.text((20, 20), "Rotated label", font)
+        return 255 - np.frombuffer(draw.tobytes(), dtype=np.uint8).astype(int)
+
+    plain = render(None)
+    # outline glyphs, rendered in one pass through the transform
+    shifted = render((0.0, 0.0))
+    assert abs(shifted.sum() - plain.sum()) < 0.05 * plain.sum()
+    rotated = render((0.866, -0.5, 40, 0.5, 0.866, 40))
+    assert abs(rotated.sum() - plain.sum()) < 0.1 * plain.sum()
+    assert (rotated != shifted).any()
+
+
+def test_text_sdf():
+    from aggdraw import Draw, Font
+    import numpy as np
+    filename = _find_font()
+
+    def render(font, transform=None, text="Distance field"):
+        draw = Draw("L", (300, 100), "white")
+        if transform:
+            draw.settransform(transform)
+        draw.text((10, 10), text, font)
+        return 255 - np.frombuffer(draw.tobytes(), dtype=np.uint8).astype(int)
+
+    for size in (10, 24, 40):
+        plain = render(Font("black", filename, size)).sum()
+        sdf = render(Font("black", filename, size, sdf=True)).sum()
+        assert abs(sdf - plain) < 0.15 * plain
+    rotated = render(Font("black", filename, 24, sdf=True),
+                     (0.966, -0.259, 0, 0.259, 0.966, 20))
+    assert rotated.sum() > 0
+
+    # fields are traced from the outline, so magnified text stays sharp
+    plain = render(Font("black", filename, 80))
+    sdf = render(Font("black", filename, 80, sdf=True))
+    assert np.abs(sdf - plain).mean() < 4
+
+    # filling the atlas clears it, and glyphs in use are traced again
+    font = Font("black", filename, 24, sdf=True)
+    first = render(font)
+    for code in range(0x100, 0x600, 20):
+        render(font, text="".join(chr(code + i) for i in range(20)))
+    assert (render(font) == first).all()
+
+
+def test_glyph_cache_file(tmp_path):
+    import struct
+    import subprocess
+    import sys
+    import aggdraw
+    filename = _find_font()
+    cache = str(tmp_path / "glyphs.cache")
+
+    script = (
+        "import aggdraw, numpy as np\n"
+        "font = aggdraw.Font('black', %r, 14)\n"
+        "%s\n"
+        "draw = aggdraw.Draw('L', (120, 30), 'white')\n"
+        "draw.text((5, 5), 'cached text', font)\n"
+        "print(int((255 - np.frombuffer(draw.tobytes(), np.uint8)).sum()))\n"
+        "aggdraw.save_glyph_cache(%r)\n"
+    )
+
+    def run(load):
+        out = subprocess.check_output(
+            [sys.executable, "-c",
+             script % (filename, load, cache)])
+        return int(out)
+
+    cold = run("")
+    # the warm run overwrites the file it has mapped
+    assert run("aggdraw.load_glyph_cache(%r)" % cache) == cold
+    assert run("aggdraw.load_glyph_cache(%r)" % cache) == cold
+
+    bad = tmp_path / "bad.cache"
+    bad.write_bytes(b"AGGGLYPH" + b"\0" * 64)
+    with pytest.raises(ValueError):
+        aggdraw.load_glyph_cache(str(bad))
+
+    # truncated files, and sizes that overflow when aligned
+    with open(cache, "rb") as f:
+        good = f.read()
+    damaged = [good[:n] for n in range(0, len(good), 61)]
+    for size in (0x7FFFFFFD, -8):
+        data = bytearray(good)
+        data[56:60] = struct.pack("i", size)
+        damaged.append(bytes(data))
+    for data in damaged:
+        bad.write_bytes(data)
+        with pytest.raises(ValueError):
+            aggdraw.load_glyph_cache(str(bad))
+
+
+def test_font_memory():
+    from aggdraw import Draw, Font
+    filename = _find_font()
+    with open(filename, "rb") as f:
+        data = f.read()
+
+    def render(font):
+        draw = Draw("L", (120, 30), "white")
+        draw.text((5, 5), "memory", font)
+        return draw.tobytes()
+
+    expected = render(Font("black", filename, 14))
+    font = Font("black", data, 14)
+    assert render(font) == expected
+    # equal data in another buffer reuses the face
+    assert render(Font("black", bytearray(data), 14)) == expected
+    del font
+    # writable buffers are copied, so changing them leaves the font intact
+    writable = bytearray(data)
+    copied = Font("black", writable, 14)
+    writable[:] = bytes(len(writable))
+    assert render(copied) == expected
+    del copied
+    assert render(Font("black", memoryview(data), 14, sdf=True)) != b""
+    with pytest.raises(IOError):
+        Font("black", b"not a font")
+
+
+def test_raster_font():
+    from aggdraw import Draw, RasterFont
+    import numpy as np
+    font = RasterFont("black", "gse7x11")
+    draw = Draw("L", (80, 20), "white")
+    assert draw.textsize("tile 12", font) == (49.0, 11.0)
+    draw.text((2, 2), u"tile 12 €", font)
+    image = np.frombuffer(draw.tobytes(), dtype=np.uint8).reshape(20, 80)
+    rows, cols = np.nonzero(image < 128)
+    assert rows.min() >= 2 and rows.max() < 2 + 11
+    assert cols.min() >= 2
+    with pytest.raises(ValueError):
+        RasterFont("black", "nosuchfont")
+
+
+def test_lazy_import():
+    import subprocess
+    import sys
+    code = ("import sys, aggdraw\n"
+            "assert 'PIL' not in sys.modules\n"
+            "aggdraw.Brush('rgb(1, 2, 3)')\n"
+            "assert 'PIL' not in sys.modules\n")
+    subprocess.check_call([sys.executable, "-c", code])
@@ -0,0 +1,36 @@
+#!/usr/bin/env python
+"""Measure how long ``import aggdraw`` takes in a fresh interpreter.
+
+Usage::
+
+    $ python ci/benchmark_import.py [runs]
+
+Each run starts a new interpreter with ``-X importtime`` and reads the
+cumulative time of the top-level ``aggdraw`` import, so interpreter start-up
+is not included. The median over all runs is reported in milliseconds.
+"""
+import statistics
+import subprocess
+import sys
+
+
+def import_time():
+    result = subprocess.run(
+        [sys.executable, "-X", "importtime", "-c", "import aggdraw"],
+        stderr=subprocess.PIPE, universal_newlines=True, check=True)
+    for line in result.stderr.splitlines():
+        fields = line.split("|")
+        if len(fields) == 3 and fields[2].strip() == "aggdraw":
+            return int(fields[1]) / 1000.0
+    raise RuntimeError("aggdraw not found in import time output")
+
+
+def main():
+    runs = int(sys.argv[1]) if len(sys.argv) > 1 else 20
+    times = [import_time() for _ in range(runs)]
+    print("import aggdraw: %.2f ms (median of %d runs, min %.2f ms)"
+          % (statistics.median(times), runs, min(times)))
+
+
+if __name__ == "__main__":
+    main()
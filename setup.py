@@ -113,6 +113,7 @@ sources = [
     "agg2/src/agg_arc.cpp",
     "agg2/src/agg_bezier_arc.cpp",
     "agg2/src/agg_curves.cpp",
+    "agg2/src/agg_embedded_raster_fonts.cpp",
     "agg2/src/agg_rounded_rect.cpp",
     "agg2/src/agg_path_storage.cpp",
     "agg2/src/agg_rasterizer_scanline_aa.cpp",
@@ -120,6 +121,8 @@ sources = [
     "agg2/src/agg_vcgen_contour.cpp",
     # "agg2/src/agg_vcgen_dash.cpp",
     "agg2/src/agg_vcgen_stroke.cpp",
+    "agg2/src/agg_vpgen_clip_polygon.cpp",
+    "agg2/src/agg_vpgen_clip_polyline.cpp",
     ]
 
 # define VERSION macro in C++ code, need to quote it
@@ -134,6 +137,7 @@ if FREETYPE_ROOT:
     defines.append(("HAVE_FREETYPE2", None))
     sources.extend([
         "agg2/font_freetype/agg_font_freetype.cpp",
+        "agg2/font_freetype/agg_font_sdf.cpp",
         ])
     include_dirs.append("agg2/font_freetype")
     include_dirs.append(os.path.join(FREETYPE_ROOT, "include"))